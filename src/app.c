@@ -1,38 +1,176 @@
 #include "app.h"
 #include "parser.h"
+#include "cache.h"
+#include "loader.h"
 #include "view.h"
 #include "view_search.h"
 #include "render.h"
 #include "input.h"
 #include "term.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
 
-int run_app(Args *args) {
-    // 1) load sequences with auto-detection
-    ParseResult *result = parse_alignment(args->filename);
-    if (!result || !result->sequences) {
-        if (result && result->error_message) {
-            fprintf(stderr, "Failed to parse alignment file '%s': %s\n", args->filename, result->error_message);
-        } else {
-            fprintf(stderr, "Failed to parse alignment file '%s'\n", args->filename);
-        }
-        if (result) {
-            free_parse_result(result);
-        }
-        return 1;
+// Loads that finish within this time show their result at once, like a plain parse
+#define APP_LOAD_GRACE_MS 200
+
+// How long the terminal gets to answer what it supports
+#define APP_TERM_QUERY_MS 200
+
+// Frames are drawn only after something changed, at most once per APP_FRAME_MS; input
+// arriving in between is folded into the next frame
+#define APP_FRAME_MS 16
+// Arrow keys further apart than this start again at the normal step
+#define APP_ACCEL_RESET_MS 30
+// How often a load still running is checked for a preview, progress or its end
+#define APP_LOAD_POLL_MS 100
+
+// Helper function to report a load that produced no sequences
+static int report_failure(const char *filename, ParseResult *result) {
+    if (result && result->error_message) {
+        fprintf(stderr, "Failed to parse alignment file '%s': %s\n", filename, result->error_message);
+    } else {
+        fprintf(stderr, "Failed to parse alignment file '%s'\n", filename);
     }
-    
-    SeqList *seqs = result->sequences;
-    AlignmentFormat format = result->format;
-    
-    // Print detected format info
+    if (result) {
+        free_parse_result(result);
+    }
+    return 1;
+}
+
+// Helper function to print what was loaded
+static void report_loaded(AlignmentFormat format, const SeqList *seqs) {
     printf("Detected format: %s\n", format_to_string(format));
     printf("Loaded %zu sequences\n", seqs->count);
-    
-    // Don't free result->sequences since we're using it
+}
+
+// Helper function to print how large and how slow the frames drawn were
+static void report_timing(void) {
+    const RenderStats *st = render_stats();
+    if (st->frames == 0) return;
+    printf("Rendered %zu frames: %.1f KB per frame (%.1f KB max), %.2f ms per frame (%.2f ms max)\n",
+           st->frames, st->bytes / 1024.0 / st->frames, st->max_bytes / 1024.0,
+           st->time_ns / 1e6 / st->frames, st->max_time_ns / 1e6);
+}
+
+// Helper function to get how long to wait for input before the loop has something to do
+// on its own; -1 to wait for input alone
+static int next_wakeup(bool dirty, bool accelerating, bool loading,
+                       long since_frame, long since_input) {
+    long wait = LONG_MAX;
+    if (dirty && APP_FRAME_MS - since_frame < wait) wait = APP_FRAME_MS - since_frame;
+    if (accelerating && APP_ACCEL_RESET_MS - since_input < wait) wait = APP_ACCEL_RESET_MS - since_input;
+    if (loading && APP_LOAD_POLL_MS < wait) wait = APP_LOAD_POLL_MS;
+    if (wait == LONG_MAX) return -1;
+    return wait > 0 ? (int)wait : 0;
+}
+
+// Helper function to send stderr to a temporary file while the alternate screen is up, so
+// parser messages neither garble the view nor get lost; returns the saved descriptor or -1
+static int hold_stderr(FILE **held) {
+    fflush(stderr);
+    *held = tmpfile();
+    int saved = *held ? dup(STDERR_FILENO) : -1;
+    if (saved < 0 || dup2(fileno(*held), STDERR_FILENO) < 0) {
+        if (saved >= 0) close(saved);
+        if (*held) fclose(*held);
+        *held = NULL;
+        return -1;
+    }
+    return saved;
+}
+
+// Helper function to restore stderr, replaying what was held back if asked to
+static void release_stderr(int saved, FILE *held, bool replay) {
+    if (saved < 0) return;
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    if (replay) {
+        rewind(held);
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), held)) > 0) fwrite(buf, 1, n, stderr);
+    }
+    fclose(held);
+}
+
+// Helper function to adopt a freshly loaded list, freeing the one it replaces
+static void adopt_result(ViewState *vs, ParseResult *result) {
+    SeqList *old = vs->seqs;
+    view_replace_seqs(vs, result->sequences);
     result->sequences = NULL;
     free_parse_result(result);
+    seqlist_free(old);
+}
+
+int run_app(Args *args) {
+    // 1) load sequences on a background thread, from the sidecar cache when allowed or with
+    //    auto-detection; small files are ready before the viewer would even show
+    //    Piped input ("-") streams in instead, with keys read from the terminal
+    ParseResult *result = NULL;
+    bool from_cache = false;
+    bool streamed = strcmp(args->filename, "-") == 0;
+    bool use_cache = args->use_cache && !streamed;
+    Loader *loader = NULL;
+    if (streamed) {
+        int fd = redirect_stdin_to_tty();
+        if (fd < 0) {
+            fprintf(stderr, "Error: No terminal to read keys from while reading piped input\n");
+            return 1;
+        }
+        loader = loader_start_stream(fd, "<stdin>");
+        if (!loader) {
+            close(fd);
+            fprintf(stderr, "Error: Cannot start reading piped input\n");
+            return 1;
+        }
+    } else {
+        loader = loader_start(args->filename, use_cache);
+    }
+    if (!loader) {
+        result = use_cache ? cache_load(args->filename) : NULL;
+        from_cache = result != NULL;
+        if (!result) result = parse_alignment(args->filename);
+    } else if (loader_wait(loader, APP_LOAD_GRACE_MS)) {
+        result = loader_take_result(loader, &from_cache);
+        loader_free(loader);
+        loader = NULL;
+    }
+    
+    SeqList *seqs = NULL;
+    AlignmentFormat format = FORMAT_UNKNOWN;
+    if (!loader) {
+        if (!result || !result->sequences) {
+            return report_failure(args->filename, result);
+        }
+        seqs = result->sequences;
+        format = result->format;
+        
+        // Print detected format info
+        report_loaded(format, seqs);
+        
+        // Don't free result->sequences since we're using it
+        result->sequences = NULL;
+        free_parse_result(result);
+        
+        if (use_cache && !from_cache) {
+            cache_save_async(args->filename, format, seqs);
+        }
+    } else {
+        // Still loading: start on an empty list and fill it in as results arrive
+        seqs = seqlist_new(0);
+        if (!seqs) {
+            fprintf(stderr, "Error: Out of memory\n");
+            return 1;
+        }
+    }
+    bool progressive = loader != NULL;
+    FILE *held = NULL;
+    int saved_stderr = progressive ? hold_stderr(&held) : -1;
+    bool load_failed = false;
 
     // 2) init terminal (alt-screen, raw mode, SIGWINCH)
     enable_raw_mode();
@@ -41,14 +179,69 @@ int run_app(Args *args) {
     // 3) init view state
     ViewState vs = view_init(seqs);
     vs.no_color = args->no_color;
+    vs.sync_output = query_sync_output(APP_TERM_QUERY_MS);
+    if (loader) vs.load_percent = 0;
 
-    // 4) main loop
+    // 4) main loop: draw when something changed, then sleep until input, a frame falls due,
+    //    acceleration runs out or a running load needs a look; idle costs nothing
     bool running = true;
+    bool dirty = true;
+    struct timespec last_frame, last_input;
+    get_current_time(&last_input);
+    last_frame = last_input;
+    last_frame.tv_sec--;  // the first frame is due at once
     while (running) {
-        render_frame(&vs);
-        
-        // Use timeout-based input reading (30ms timeout for acceleration reset)
-        InputEvt ev = input_read_timeout(30);
+        if (loader) {
+            // Show the first records as soon as they are parsed, then the whole file
+            ParseResult *preview = loader_take_preview(loader);
+            if (preview) {
+                adopt_result(&vs, preview);
+                dirty = true;
+            }
+            if (loader_wait(loader, 0)) {
+                result = loader_take_result(loader, &from_cache);
+                loader_free(loader);
+                loader = NULL;
+                vs.load_percent = -1;
+                dirty = true;
+                if (!result || !result->sequences) {
+                    load_failed = true;
+                    break;
+                }
+                format = result->format;
+                adopt_result(&vs, result);
+                result = NULL;
+                if (use_cache && !from_cache) {
+                    cache_save_async(args->filename, format, vs.seqs);
+                }
+            } else {
+                int percent = parse_progress_percent();
+                if (percent < 0) percent = 0;
+                if (percent != vs.load_percent) {
+                    vs.load_percent = percent;
+                    dirty = true;
+                }
+            }
+        }
+
+        struct timespec now;
+        get_current_time(&now);
+        if (dirty && time_diff_ms(&last_frame, &now) >= APP_FRAME_MS) {
+            render_frame(&vs);
+            dirty = false;
+            last_frame = now;
+        }
+
+        bool accelerating = vs.last_key != 0;
+        int timeout = next_wakeup(dirty, accelerating, loader != NULL,
+                                  time_diff_ms(&last_frame, &now), time_diff_ms(&last_input, &now));
+        InputEvt ev = input_read_timeout(timeout);
+        if (ev.type == EVT_KEY || ev.type == EVT_MOUSE) {
+            get_current_time(&last_input);
+        }
+        if (ev.type == EVT_KEY || ev.type == EVT_MOUSE || ev.type == EVT_RESIZE) {
+            dirty = true;
+        }
         
         switch (ev.type) {
             case EVT_KEY:
@@ -109,11 +302,13 @@ int run_app(Args *args) {
                     } else if (ev.key == 3) { // Ctrl+C
                         if (vs.has_selection) {
                             view_copy_selection(&vs);
+                            render_invalidate();
                         }
                         view_reset_acceleration(&vs);
                     } else if ((ev.key == 'c' || ev.key == 'C') && vs.has_selection) {
                         // 'c' key to copy when selection is active
                         view_copy_selection(&vs);
+                        render_invalidate();
                         view_reset_acceleration(&vs);
                     } else if (ev.key == ARROW_UP) {
                         view_update_acceleration(&vs, ARROW_UP);
@@ -182,6 +377,7 @@ int run_app(Args *args) {
                     if (vs.has_selection) {
                         // Copy selection to clipboard
                         view_copy_selection(&vs);
+                        render_invalidate();
                     }
                 }
                 break;
@@ -189,8 +385,12 @@ int run_app(Args *args) {
                 view_resize(&vs);
                 break;
             case EVT_TIMEOUT:
-                // Reset acceleration on timeout (user stopped pressing keys)
-                view_reset_acceleration(&vs);
+                // Reset acceleration once the user stopped pressing keys; other wakeups
+                // (a frame falling due, a load poll) leave it alone
+                get_current_time(&now);
+                if (accelerating && time_diff_ms(&last_input, &now) >= APP_ACCEL_RESET_MS) {
+                    view_reset_acceleration(&vs);
+                }
                 break;
             default:
                 break;
@@ -200,5 +400,19 @@ int run_app(Args *args) {
     // 5) restore terminal
     disable_altscreen();
     disable_raw_mode();
+    release_stderr(saved_stderr, held, load_failed);
+    if (args->show_timing) {
+        report_timing();
+    }
+    if (load_failed) {
+        return report_failure(args->filename, result);
+    }
+    // A load still running when the user quit simply ends with the process
+    if (progressive && !loader) {
+        report_loaded(format, vs.seqs);
+    }
+    
+    // let a cache started on this run reach the disk
+    cache_wait();
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include "arena.h"
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    char *data;       // start of the usable space
+    size_t used, size;
+};
+
+// Helper function to round a size up to the arena alignment
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Helper function to allocate a chunk header followed by size bytes of space
+static ArenaChunk *new_chunk(size_t size) {
+    ArenaChunk *c = malloc(align_up(sizeof(ArenaChunk)) + size);
+    if (!c) return NULL;
+    c->next = NULL;
+    c->data = (char *)c + align_up(sizeof(ArenaChunk));
+    c->used = 0;
+    c->size = size;
+    return c;
+}
+
+void arena_init(Arena *a, size_t chunk_size) {
+    a->head = NULL;
+    a->chunk_size = chunk_size;
+}
+
+// Helper function to carve size bytes at the given alignment out of the arena
+static void *bump(Arena *a, size_t size, size_t align) {
+    if (size == 0) size = 1;
+    ArenaChunk *c = a->head;
+    if (c) {
+        size_t at = (c->used + align - 1) & ~(align - 1);
+        if (at <= c->size && c->size - at >= size) {
+            c->used = at + size;
+            return c->data + at;
+        }
+    }
+
+    // Big requests get a chunk of their own, kept behind the one being filled
+    if (size > a->chunk_size / 4) {
+        ArenaChunk *big = new_chunk(size);
+        if (!big) return NULL;
+        big->used = size;
+        if (c) {
+            big->next = c->next;
+            c->next = big;
+        } else {
+            a->head = big;
+        }
+        return big->data;
+    }
+
+    ArenaChunk *fresh = new_chunk(a->chunk_size);
+    if (!fresh) return NULL;
+    fresh->next = c;
+    a->head = fresh;
+    fresh->used = size;
+    return fresh->data;
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    return bump(a, size, ARENA_ALIGN);
+}
+
+char *arena_strndup(Arena *a, const char *s, size_t n) {
+    // strings need no alignment, so names pack back to back
+    char *p = bump(a, n + 1, 1);
+    if (!p) return NULL;
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+int arena_adopt(Arena *a, void *block) {
+    // The adopted block is tracked by a zero-sized chunk that points at it
+    ArenaChunk *c = malloc(sizeof(ArenaChunk));
+    if (!c) return -1;
+    c->data = block;
+    c->used = c->size = 0;
+    if (a->head) {
+        c->next = a->head->next;
+        a->head->next = c;
+    } else {
+        c->next = NULL;
+        a->head = c;
+    }
+    return 0;
+}
+
+void arena_free(Arena *a) {
+    ArenaChunk *c = a->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        if (c->data != (char *)c + align_up(sizeof(ArenaChunk))) free(c->data);
+        free(c);
+        c = next;
+    }
+    a->head = NULL;
+}
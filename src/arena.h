@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+
+// Bump allocator: many small allocations carved out of a few large chunks,
+// all released together by arena_free.
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;   // chunk currently being filled, followed by older ones
+    size_t chunk_size;  // size of regular chunks
+} Arena;
+
+void arena_init(Arena *a, size_t chunk_size);
+
+// Allocate size bytes aligned for any object; returns NULL when out of memory
+void *arena_alloc(Arena *a, size_t size);
+
+// Copy s[0..n) into the arena as a NUL-terminated string
+char *arena_strndup(Arena *a, const char *s, size_t n);
+
+// Hand a malloc'd block over to the arena, which frees it along with its chunks
+int arena_adopt(Arena *a, void *block);
+
+// Release every allocation at once
+void arena_free(Arena *a);
@@ -3,10 +3,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 Args parse_args(int argc, char **argv) {
     Args args = {
         .no_color = false,
+        .use_cache = false,
+        .show_timing = false,
         .filename = NULL,
         .show_help = false,
         .show_version = false,
@@ -30,6 +33,10 @@ Args parse_args(int argc, char **argv) {
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--no-color") == 0 || strcmp(argv[i], "-n") == 0) {
             args.no_color = true;
+        } else if (strcmp(argv[i], "--cache") == 0 || strcmp(argv[i], "-c") == 0) {
+            args.use_cache = true;
+        } else if (strcmp(argv[i], "--timing") == 0 || strcmp(argv[i], "-t") == 0) {
+            args.show_timing = true;
         } else if (args.filename == NULL) {
             args.filename = argv[i];
         } else {
@@ -39,6 +46,11 @@ Args parse_args(int argc, char **argv) {
         }
     }
     
+    // Read piped input when no file is named
+    if (args.filename == NULL && !isatty(STDIN_FILENO)) {
+        args.filename = "-";
+    }
+
     if (args.filename == NULL) {
         args.has_error = true;
         args.error_message = "No input file specified";
@@ -49,11 +61,14 @@ Args parse_args(int argc, char **argv) {
 }
 
 void show_help(const char *program_name) {
-    printf("Usage: %s [options] <alignment_file>\n", program_name);
+    printf("Usage: %s [options] <alignment_file | ->\n", program_name);
+    printf("       ... | %s [options]      (read the alignment from a pipe)\n", program_name);
     printf("Options:\n");
     printf("  -v, --version      Show version information\n");
     printf("  -h, --help         Show this help message\n");
     printf("  -n, --no-color     Disable ANSI color codes\n");
+    printf("  -c, --cache        Reopen from / save to a <file>.showali cache\n");
+    printf("  -t, --timing       Report frame size and render time on exit\n");
     printf("\nControls:\n");
     printf("  Arrow keys         Navigate (hold for acceleration)\n");
     printf("  WASD               Navigate (jump half-screen)\n");
@@ -4,6 +4,8 @@
 // Structure to hold parsed command-line arguments
 typedef struct {
     bool no_color;
+    bool use_cache;
+    bool show_timing;
     char *filename;
     bool show_help;
     bool show_version;
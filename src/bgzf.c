@@ -0,0 +1,302 @@
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "bgzf.h"
+#include "workpool.h"
+
+// Blocks inflated per worker task
+#define BGZF_BLOCKS_PER_TASK 16
+
+// Fixed part of a gzip member header, up to and including XLEN, and of its trailer
+#define GZIP_HEADER_BYTES  12
+#define GZIP_TRAILER_BYTES 8
+
+// Helper function to read little-endian integers out of a header
+static inline unsigned read_le16(const unsigned char *p) {
+    return p[0] | (unsigned)p[1] << 8;
+}
+
+static inline uint32_t read_le32(const unsigned char *p) {
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool gzip_detect(const char *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    return size >= 3 && p[0] == 0x1f && p[1] == 0x8b && p[2] == 8;
+}
+
+// Helper function to find the BGZF block size of the gzip member at p; 0 if it is not a BGZF block
+static size_t bgzf_block_bytes(const unsigned char *p, size_t avail) {
+    if (avail < GZIP_HEADER_BYTES || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4)) return 0;
+    size_t xlen = read_le16(p + 10);
+    if (avail < GZIP_HEADER_BYTES + xlen) return 0;
+
+    // The extra field holds subfields; BGZF stores the block size minus one in "BC"
+    const unsigned char *x = p + GZIP_HEADER_BYTES, *x_end = x + xlen;
+    while (x_end - x >= 4) {
+        size_t slen = read_le16(x + 2);
+        if ((size_t)(x_end - x - 4) < slen) return 0;
+        if (x[0] == 'B' && x[1] == 'C' && slen == 2) {
+            size_t bytes = read_le16(x + 4) + 1;
+            if (bytes < GZIP_HEADER_BYTES + xlen + GZIP_TRAILER_BYTES || bytes > avail) return 0;
+            return bytes;
+        }
+        x += 4 + slen;
+    }
+    return 0;
+}
+
+int bgzf_index_build(const char *data, size_t size, BgzfIndex *idx) {
+    memset(idx, 0, sizeof(BgzfIndex));
+    if (size == 0) return -1;
+
+    const unsigned char *p = (const unsigned char *)data;
+    size_t capacity = 0;
+    uint64_t coffset = 0, uoffset = 0;
+    while (1) {
+        if (idx->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            uint64_t *c = realloc(idx->coffset, capacity * sizeof(uint64_t));
+            if (c) idx->coffset = c;
+            uint64_t *u = realloc(idx->uoffset, capacity * sizeof(uint64_t));
+            if (u) idx->uoffset = u;
+            if (!c || !u) break;
+        }
+        // The last entry only marks where the text ends
+        idx->coffset[idx->count] = coffset;
+        idx->uoffset[idx->count] = uoffset;
+        if (coffset == size) return 0;
+        idx->count++;
+
+        size_t bytes = bgzf_block_bytes(p + coffset, size - coffset);
+        if (bytes == 0) break;
+        uint32_t isize = read_le32(p + coffset + bytes - 4);
+        if (isize > BGZF_BLOCK_SIZE) break;
+        coffset += bytes;
+        uoffset += isize;
+    }
+    bgzf_index_free(idx);
+    return -1;
+}
+
+void bgzf_index_free(BgzfIndex *idx) {
+    free(idx->coffset);
+    free(idx->uoffset);
+    memset(idx, 0, sizeof(BgzfIndex));
+}
+
+uint64_t bgzf_size(const BgzfIndex *idx) {
+    return idx->uoffset[idx->count];
+}
+
+uint64_t bgzf_virtual_offset(const BgzfIndex *idx, uint64_t uoffset) {
+    // Last block starting at or before the offset
+    size_t lo = 0, hi = idx->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->uoffset[mid] <= uoffset) lo = mid;
+        else hi = mid;
+    }
+    return idx->coffset[lo] << 16 | (uoffset - idx->uoffset[lo]);
+}
+
+// Helper function to inflate block b into out with a raw inflate stream; 0 on success
+static int inflate_block(z_stream *zs, const char *data, const BgzfIndex *idx, size_t b, char *out) {
+    const unsigned char *p = (const unsigned char *)data + idx->coffset[b];
+    size_t bytes = idx->coffset[b + 1] - idx->coffset[b];
+    size_t xlen = read_le16(p + 10);
+    size_t isize = idx->uoffset[b + 1] - idx->uoffset[b];
+
+    if (inflateReset(zs) != Z_OK) return -1;
+    zs->next_in = (unsigned char *)p + GZIP_HEADER_BYTES + xlen;
+    zs->avail_in = (unsigned)(bytes - GZIP_HEADER_BYTES - xlen - GZIP_TRAILER_BYTES);
+    zs->next_out = (unsigned char *)out;
+    zs->avail_out = (unsigned)isize;
+    if (inflate(zs, Z_FINISH) != Z_STREAM_END || zs->total_out != isize) return -1;
+
+    uint32_t crc = read_le32(p + bytes - GZIP_TRAILER_BYTES);
+    return crc32(0, (const unsigned char *)out, (unsigned)isize) == crc ? 0 : -1;
+}
+
+typedef struct {
+    const char      *data;
+    const BgzfIndex *idx;
+    size_t           first;
+    char            *out;
+    atomic_bool      failed;
+} InflateJob;
+
+// Helper function to inflate one range of blocks, relative to the job's first block
+static void inflate_blocks(size_t begin, size_t end, void *arg) {
+    InflateJob *job = arg;
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        atomic_store(&job->failed, true);
+        return;
+    }
+    uint64_t base = job->idx->uoffset[job->first];
+    for (size_t i = begin; i < end && !atomic_load(&job->failed); i++) {
+        size_t b = job->first + i;
+        if (inflate_block(&zs, job->data, job->idx, b, job->out + (job->idx->uoffset[b] - base)) != 0) {
+            atomic_store(&job->failed, true);
+        }
+    }
+    inflateEnd(&zs);
+}
+
+int bgzf_inflate_blocks(const char *data, const BgzfIndex *idx, size_t first, size_t last, char *out) {
+    if (last <= first) return 0;
+    InflateJob job = { data, idx, first, out, false };
+    workpool_run(last - first, BGZF_BLOCKS_PER_TASK, inflate_blocks, &job);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+// Helper function to inflate plain gzip data, one member after another, until max_bytes of text;
+// returns the heap buffer (NULL on failure) and its size in out_size
+static char *inflate_stream(const char *data, size_t size, size_t max_bytes, size_t *out_size) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return NULL;
+
+    const unsigned char *in = (const unsigned char *)data, *in_end = in + size;
+    zs.next_in = (unsigned char *)in;
+    size_t capacity = size < max_bytes / 4 ? size * 4 : max_bytes;
+    if (capacity < BGZF_BLOCK_SIZE) capacity = BGZF_BLOCK_SIZE;
+    char *out = malloc(capacity);
+    size_t got = 0;
+    while (out && got < max_bytes) {
+        if (got == capacity) {
+            capacity = capacity < max_bytes / 2 ? capacity * 2 : max_bytes;
+            char *bigger = realloc(out, capacity);
+            if (!bigger) goto failed;
+            out = bigger;
+        }
+        // zlib counts in 32 bits, so feed huge inputs and outputs piecewise
+        if (zs.avail_in == 0) {
+            size_t rest = in_end - zs.next_in;
+            zs.avail_in = rest > UINT_MAX ? UINT_MAX : (unsigned)rest;
+        }
+        size_t room = capacity - got;
+        zs.next_out = (unsigned char *)out + got;
+        zs.avail_out = room > UINT_MAX ? UINT_MAX : (unsigned)room;
+        unsigned before = zs.avail_out;
+        int rc = inflate(&zs, Z_NO_FLUSH);
+        got += before - zs.avail_out;
+
+        if (rc == Z_STREAM_END) {
+            // Concatenated members make up one text; anything else after the last is ignored
+            size_t rest = in_end - zs.next_in;
+            if (!gzip_detect((const char *)zs.next_in, rest)) break;
+            if (inflateReset(&zs) != Z_OK) goto failed;
+        } else if (rc != Z_OK && !(rc == Z_BUF_ERROR && zs.avail_out == 0)) {
+            goto failed;
+        }
+    }
+    if (!out) goto failed;
+    inflateEnd(&zs);
+    *out_size = got < max_bytes ? got : max_bytes;
+    return out;
+
+failed:
+    inflateEnd(&zs);
+    free(out);
+    return NULL;
+}
+
+int gzip_inflate_file(MappedFile *mf, size_t max_bytes) {
+    char *out = NULL;
+    size_t out_size = 0;
+
+    BgzfIndex idx;
+    if (bgzf_index_build(mf->data, mf->size, &idx) == 0) {
+        // Only the blocks that reach into the first max_bytes are needed
+        size_t last = 0;
+        while (last < idx.count && idx.uoffset[last] < max_bytes) last++;
+        uint64_t total = idx.uoffset[last];
+        out = malloc(total ? total : 1);
+        if (out && bgzf_inflate_blocks(mf->data, &idx, 0, last, out) != 0) {
+            free(out);
+            out = NULL;
+        }
+        out_size = total < max_bytes ? total : max_bytes;
+        bgzf_index_free(&idx);
+    } else {
+        out = inflate_stream(mf->data, mf->size, max_bytes, &out_size);
+    }
+    if (!out) return -1;
+
+    mapped_file_close(mf);
+    mf->data = out;
+    mf->size = out_size;
+    mf->heap = true;
+    return 0;
+}
+
+int bgzf_reader_init(BgzfReader *rd, const char *data, const BgzfIndex *idx) {
+    rd->data = data;
+    rd->index = idx;
+    rd->cache = malloc((size_t)BGZF_CACHE_BLOCKS * BGZF_BLOCK_SIZE);
+    if (!rd->cache) return -1;
+    for (size_t s = 0; s < BGZF_CACHE_BLOCKS; s++) rd->cached[s] = SIZE_MAX;
+    pthread_mutex_init(&rd->lock, NULL);
+    return 0;
+}
+
+size_t bgzf_read(BgzfReader *rd, uint64_t voffset, size_t n, char *out) {
+    const BgzfIndex *idx = rd->index;
+    uint64_t coffset = voffset >> 16;
+    size_t within = voffset & 0xFFFF;
+
+    // The block starting at the virtual offset's file offset
+    size_t lo = 0, hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->coffset[mid] < coffset) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo >= idx->count || idx->coffset[lo] != coffset) return 0;
+
+    pthread_mutex_lock(&rd->lock);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    bool stream_ready = false;
+    size_t done = 0;
+    for (size_t b = lo; b < idx->count && done < n; b++, within = 0) {
+        size_t block_len = idx->uoffset[b + 1] - idx->uoffset[b];
+        if (within >= block_len) {
+            if (within > block_len) break;
+            continue;
+        }
+
+        // Blocks map to cache slots by number, so neighbouring blocks never evict each other
+        size_t slot = b % BGZF_CACHE_BLOCKS;
+        char *text = rd->cache + slot * (size_t)BGZF_BLOCK_SIZE;
+        if (rd->cached[slot] != b) {
+            rd->cached[slot] = SIZE_MAX;
+            if (!stream_ready) {
+                if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) break;
+                stream_ready = true;
+            }
+            if (inflate_block(&zs, rd->data, idx, b, text) != 0) break;
+            rd->cached[slot] = b;
+        }
+
+        size_t take = block_len - within;
+        if (take > n - done) take = n - done;
+        memcpy(out + done, text + within, take);
+        done += take;
+    }
+    if (stream_ready) inflateEnd(&zs);
+    pthread_mutex_unlock(&rd->lock);
+    return done;
+}
+
+void bgzf_reader_free(BgzfReader *rd) {
+    if (!rd->cache) return;
+    free(rd->cache);
+    rd->cache = NULL;
+    pthread_mutex_destroy(&rd->lock);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mapped_file.h"
+
+// Largest decompressed size of one BGZF block
+#define BGZF_BLOCK_SIZE (64u << 10)
+// Inflated blocks a reader keeps around
+#define BGZF_CACHE_BLOCKS 64
+
+// Block layout of a BGZF file, as in a bgzip .gzi index: block b starts at byte coffset[b] of the
+// file and at byte uoffset[b] of the decompressed text; entry count marks the end of the last block
+typedef struct {
+    uint64_t *coffset;
+    uint64_t *uoffset;
+    size_t    count;
+} BgzfIndex;
+
+// Random access to the text of a BGZF file by virtual offset, through a small cache of inflated blocks
+typedef struct {
+    const char      *data;   // the compressed file, owned by the caller
+    const BgzfIndex *index;  // its block layout, owned by the caller
+    pthread_mutex_t  lock;   // guards the cache, so rows may be read from worker threads
+    char            *cache;  // BGZF_CACHE_BLOCKS slots of BGZF_BLOCK_SIZE bytes
+    size_t           cached[BGZF_CACHE_BLOCKS];  // block held by each slot (SIZE_MAX if none)
+} BgzfReader;
+
+// Check if data starts with a gzip member (BGZF files included)
+bool gzip_detect(const char *data, size_t size);
+
+// Replace the gzip contents of mf with at most max_bytes of its decompressed text, kept on the heap.
+// BGZF blocks are inflated in parallel. Returns 0 on success, -1 on corrupt data or out of memory
+int  gzip_inflate_file(MappedFile *mf, size_t max_bytes);
+
+// Index a BGZF file by walking its block headers, without inflating anything; returns 0 on success,
+// -1 if the data is not BGZF (plain gzip included)
+int  bgzf_index_build(const char *data, size_t size, BgzfIndex *idx);
+void bgzf_index_free(BgzfIndex *idx);
+
+// Size of the decompressed text
+uint64_t bgzf_size(const BgzfIndex *idx);
+
+// Virtual offset of a decompressed offset: the file offset of its block << 16 | the offset within it
+uint64_t bgzf_virtual_offset(const BgzfIndex *idx, uint64_t uoffset);
+
+// Inflate blocks [first, last) into out, which takes uoffset[last] - uoffset[first] bytes, on the
+// worker pool; returns 0 on success, -1 on corrupt data
+int  bgzf_inflate_blocks(const char *data, const BgzfIndex *idx, size_t first, size_t last, char *out);
+
+// Set up a reader over an indexed file; returns 0 on success, -1 when out of memory
+int  bgzf_reader_init(BgzfReader *rd, const char *data, const BgzfIndex *idx);
+
+// Copy up to n bytes of text from a virtual offset on, across blocks; returns the count copied,
+// which is short at the end of the text or on corrupt data
+size_t bgzf_read(BgzfReader *rd, uint64_t voffset, size_t n, char *out);
+void bgzf_reader_free(BgzfReader *rd);
@@ -0,0 +1,366 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "gapindex.h"
+#include "nucpack.h"
+
+#define CACHE_SUFFIX       ".showali"
+#define CACHE_MAGIC        "SHOWALI"
+#define CACHE_VERSION      1
+#define CACHE_BYTE_ORDER   0x01020304u
+#define CACHE_HASH_SAMPLES 64
+#define CACHE_HASH_WINDOW  4096
+
+// Identity of the source file the cache was built from
+typedef struct {
+    uint64_t size;
+    int64_t  mtime_sec, mtime_nsec;
+    uint64_t hash;  // FNV-1a over evenly spaced windows of the file
+} CacheStamp;
+
+typedef struct {
+    char       magic[8];
+    uint32_t   version;
+    uint32_t   byte_order;  // catches caches copied between machines of different endianness
+    CacheStamp stamp;
+    uint32_t   format, list_type;
+    uint64_t   row_count;
+    uint64_t   rows_offset;  // CacheRow table
+    uint64_t   source_offset, source_size;  // blob written by the source's save hook
+    uint64_t   file_size;
+} CacheHeader;
+
+enum {
+    CACHE_ROW_PLAIN  = 1 << 0,  // data holds stored_len plain residues
+    CACHE_ROW_PACKED = 1 << 1,  // data holds 4-bit codes (see nucpack.h)
+    CACHE_ROW_T_IS_U = 1 << 2,
+    CACHE_ROW_GAPS   = 1 << 3   // gap_* arrays hold the row's gap index
+};
+
+// One row; every offset counts from the start of the cache file
+typedef struct {
+    uint64_t id;          // NUL-terminated row name
+    uint64_t len;         // columns
+    uint64_t stored_len;  // residues kept (columns minus indexed gaps)
+    uint64_t data;
+    uint64_t mask;        // soft-mask words of a packed row (0 if none)
+    uint64_t exc_pos, exc_chr, exc_count;
+    uint64_t gap_start, gap_length, gap_before, gap_count;
+    uint32_t type;
+    uint32_t flags;
+} CacheRow;
+
+// Helper function to build "<path>.showali"
+static char *cache_path(const char *path, const char *extra) {
+    size_t n = strlen(path) + strlen(CACHE_SUFFIX) + strlen(extra) + 1;
+    char *p = malloc(n);
+    if (p) snprintf(p, n, "%s%s%s", path, CACHE_SUFFIX, extra);
+    return p;
+}
+
+// Helper function to identify the current contents of the source file
+static int cache_stamp(const char *path, CacheStamp *stamp) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    memset(stamp, 0, sizeof(*stamp));
+    stamp->size = (uint64_t)st.st_size;
+    stamp->mtime_sec = st.st_mtim.tv_sec;
+    stamp->mtime_nsec = st.st_mtim.tv_nsec;
+
+    // Hashing every byte would cost as much as parsing, so sample windows across the file
+    uint64_t h = 1469598103934665603ull;
+    char buf[CACHE_HASH_WINDOW];
+    for (int k = 0; k < CACHE_HASH_SAMPLES; k++) {
+        uint64_t at = stamp->size > sizeof(buf)
+                    ? (stamp->size - sizeof(buf)) / (CACHE_HASH_SAMPLES - 1) * k : 0;
+        ssize_t got = pread(fd, buf, sizeof(buf), (off_t)at);
+        if (got < 0) {
+            close(fd);
+            return -1;
+        }
+        for (ssize_t i = 0; i < got; i++) {
+            h ^= (unsigned char)buf[i];
+            h *= 1099511628211ull;
+        }
+        if (stamp->size <= sizeof(buf)) break;
+    }
+    stamp->hash = h;
+    close(fd);
+    return 0;
+}
+
+// Helper function to check that [offset, offset + size) lies inside the file
+static bool in_file(const MappedFile *mf, uint64_t offset, uint64_t size) {
+    return offset <= mf->size && size <= mf->size - offset;
+}
+
+ParseResult *cache_load(const char *path) {
+    if (sizeof(size_t) != sizeof(uint64_t)) return NULL;
+
+    CacheStamp stamp;
+    if (cache_stamp(path, &stamp) != 0) return NULL;
+
+    char *cpath = cache_path(path, "");
+    MappedFile mf;
+    int rc = cpath ? mapped_file_open(&mf, cpath) : -1;
+    free(cpath);
+    if (rc != 0) return NULL;
+    // Rows are read in any order from here on
+    if (mf.data) madvise((void *)mf.data, mf.size, MADV_NORMAL);
+
+    const char *base = mf.data;
+    CacheHeader hdr;
+    if (mf.size < sizeof(hdr)) goto stale;
+    memcpy(&hdr, base, sizeof(hdr));
+    if (memcmp(hdr.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || hdr.version != CACHE_VERSION ||
+        hdr.byte_order != CACHE_BYTE_ORDER || hdr.file_size != mf.size ||
+        memcmp(&hdr.stamp, &stamp, sizeof(stamp)) != 0) {
+        goto stale;
+    }
+    if (hdr.row_count > mf.size / sizeof(CacheRow) ||
+        !in_file(&mf, hdr.rows_offset, hdr.row_count * sizeof(CacheRow)) ||
+        !in_file(&mf, hdr.source_offset, hdr.source_size)) {
+        goto stale;
+    }
+
+    SeqList *sl = seqlist_new(hdr.row_count);
+    if (!sl) goto stale;
+    sl->packed = calloc(sl->capacity, sizeof(PackedRow *));
+    sl->gaps = calloc(sl->capacity, sizeof(GapIndex *));
+    if (!sl->packed || !sl->gaps) goto broken;
+
+    // Rows point straight into the mapping; only small descriptors are allocated
+    const CacheRow *rows = (const CacheRow *)(base + hdr.rows_offset);
+    for (size_t i = 0; i < hdr.row_count; i++) {
+        const CacheRow *r = &rows[i];
+        if (r->id >= mf.size || !memchr(base + r->id, '\0', mf.size - r->id) || r->stored_len > r->len) {
+            goto broken;
+        }
+        sl->ids[i] = (char *)(base + r->id);
+        sl->seqs[i] = NULL;
+        sl->lens[i] = r->len;
+        sl->types[i] = r->type <= SEQ_UNKNOWN ? (SequenceType)r->type : SEQ_UNKNOWN;
+        sl->packed[i] = NULL;
+        sl->gaps[i] = NULL;
+        sl->count = i + 1;
+
+        if (r->flags & CACHE_ROW_GAPS) {
+            GapIndex *gi = arena_alloc(&sl->meta, sizeof(GapIndex));
+            size_t bytes = r->gap_count * sizeof(uint64_t);
+            if (!gi || r->gap_count > mf.size / sizeof(uint64_t) ||
+                !in_file(&mf, r->gap_start, bytes) || !in_file(&mf, r->gap_length, bytes) ||
+                !in_file(&mf, r->gap_before, bytes)) {
+                goto broken;
+            }
+            gi->count = r->gap_count;
+            gi->start = (size_t *)(base + r->gap_start);
+            gi->length = (size_t *)(base + r->gap_length);
+            gi->before = (size_t *)(base + r->gap_before);
+            gi->total = r->len - r->stored_len;
+            sl->gaps[i] = gi;
+        }
+
+        if (r->flags & CACHE_ROW_PLAIN) {
+            if (!in_file(&mf, r->data, r->stored_len)) goto broken;
+            sl->seqs[i] = (char *)(base + r->data);
+        } else if (r->flags & CACHE_ROW_PACKED) {
+            PackedRow *pr = arena_alloc(&sl->meta, sizeof(PackedRow));
+            if (!pr || r->exc_count > mf.size / sizeof(uint64_t) ||
+                !in_file(&mf, r->data, (r->stored_len + 1) / 2) ||
+                (r->mask && !in_file(&mf, r->mask, (r->stored_len + 63) / 64 * sizeof(uint64_t))) ||
+                !in_file(&mf, r->exc_pos, r->exc_count * sizeof(uint64_t)) ||
+                !in_file(&mf, r->exc_chr, r->exc_count)) {
+                goto broken;
+            }
+            pr->codes = (unsigned char *)(base + r->data);
+            pr->mask = r->mask ? (uint64_t *)(base + r->mask) : NULL;
+            pr->exc_pos = (size_t *)(base + r->exc_pos);
+            pr->exc_chr = (char *)(base + r->exc_chr);
+            pr->exc_count = r->exc_count;
+            pr->t_is_u = (r->flags & CACHE_ROW_T_IS_U) != 0;
+            sl->packed[i] = pr;
+        }
+    }
+
+    if (hdr.format == FORMAT_MAF) {
+        sl->source = restore_maf_source(path, base + hdr.source_offset, hdr.source_size);
+        if (!sl->source) goto broken;
+    }
+    sl->type = hdr.list_type <= SEQ_UNKNOWN ? (SequenceType)hdr.list_type : SEQ_UNKNOWN;
+    sl->backing = mf;
+
+    ParseResult *result = calloc(1, sizeof(ParseResult));
+    if (!result) {
+        seqlist_free(sl);
+        return NULL;
+    }
+    result->format = (AlignmentFormat)hdr.format;
+    result->sequences = sl;
+    return result;
+
+broken:
+    seqlist_free(sl);
+stale:
+    mapped_file_close(&mf);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+
+typedef struct {
+    FILE *out;
+    uint64_t pos;  // bytes written so far
+    bool failed;
+} CacheWriter;
+
+// Helper function to append bytes and return the offset they were written at
+static uint64_t put(CacheWriter *w, const void *p, size_t n) {
+    uint64_t at = w->pos;
+    if (n && fwrite(p, 1, n, w->out) != n) w->failed = true;
+    w->pos += n;
+    return at;
+}
+
+// Helper function to pad the output to an 8-byte boundary
+static void align8(CacheWriter *w) {
+    static const char zeros[8];
+    put(w, zeros, (8 - (w->pos & 7)) & 7);
+}
+
+typedef struct {
+    char *path;
+    AlignmentFormat format;
+    SeqList *sl;
+    CacheStamp stamp;
+} CacheJob;
+
+static pthread_t writer_thread;
+static bool writer_running = false;
+
+// Helper function to write a whole cache file; returns 0 on success
+static int write_cache(CacheJob *job, FILE *out) {
+    SeqList *sl = job->sl;
+    CacheWriter w = { out, 0, false };
+    CacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    put(&w, &hdr, sizeof(hdr));  // rewritten once the offsets are known
+
+    CacheRow *rows = calloc(sl->count ? sl->count : 1, sizeof(CacheRow));
+    if (!rows) return -1;
+
+    for (size_t i = 0; i < sl->count && !w.failed; i++) {
+        CacheRow *r = &rows[i];
+        r->id = put(&w, sl->ids[i], strlen(sl->ids[i]) + 1);
+        r->len = sl->lens[i];
+        r->stored_len = seqlist_stored_len(sl, i);
+        r->type = sl->types[i];
+        align8(&w);
+
+        GapIndex *gi = sl->gaps ? sl->gaps[i] : NULL;
+        if (gi) {
+            r->flags |= CACHE_ROW_GAPS;
+            r->gap_count = gi->count;
+            r->gap_start = put(&w, gi->start, gi->count * sizeof(size_t));
+            r->gap_length = put(&w, gi->length, gi->count * sizeof(size_t));
+            r->gap_before = put(&w, gi->before, gi->count * sizeof(size_t));
+        }
+
+        PackedRow *pr = sl->packed ? sl->packed[i] : NULL;
+        if (sl->seqs[i]) {
+            r->flags |= CACHE_ROW_PLAIN;
+            r->data = put(&w, sl->seqs[i], r->stored_len);
+            put(&w, "", 1);
+        } else if (pr) {
+            r->flags |= CACHE_ROW_PACKED | (pr->t_is_u ? CACHE_ROW_T_IS_U : 0);
+            r->exc_count = pr->exc_count;
+            r->exc_pos = put(&w, pr->exc_pos, pr->exc_count * sizeof(size_t));
+            if (pr->mask) r->mask = put(&w, pr->mask, (r->stored_len + 63) / 64 * sizeof(uint64_t));
+            r->data = put(&w, pr->codes, (r->stored_len + 1) / 2);
+            r->exc_chr = put(&w, pr->exc_chr, pr->exc_count);
+        }
+        align8(&w);
+    }
+
+    hdr.rows_offset = put(&w, rows, sl->count * sizeof(CacheRow));
+    free(rows);
+
+    if (sl->source && sl->source->save) {
+        hdr.source_offset = w.pos;
+        if (sl->source->save(sl->source, out) != 0) w.failed = true;
+        hdr.source_size = (uint64_t)ftell(out) - hdr.source_offset;
+        w.pos += hdr.source_size;
+    } else if (sl->source) {
+        return -1;  // rows served by a source that cannot be saved
+    }
+
+    memcpy(hdr.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    hdr.version = CACHE_VERSION;
+    hdr.byte_order = CACHE_BYTE_ORDER;
+    hdr.stamp = job->stamp;
+    hdr.format = job->format;
+    hdr.list_type = sl->type;
+    hdr.row_count = sl->count;
+    hdr.file_size = w.pos;
+    if (w.failed || fseek(out, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, out) != 1) return -1;
+    return fflush(out) == 0 ? 0 : -1;
+}
+
+static void *writer_main(void *arg) {
+    CacheJob *job = arg;
+    char *final_path = cache_path(job->path, "");
+    char *tmp_path = cache_path(job->path, ".tmp");
+    FILE *out = tmp_path ? fopen(tmp_path, "wb") : NULL;
+
+    // Write next to the final name and rename, so readers never see a partial cache
+    if (out) {
+        int rc = write_cache(job, out);
+        if (fclose(out) != 0) rc = -1;
+        if (rc != 0 || rename(tmp_path, final_path) != 0) unlink(tmp_path);
+    }
+    free(final_path);
+    free(tmp_path);
+    free(job->path);
+    free(job);
+    return NULL;
+}
+
+void cache_save_async(const char *path, AlignmentFormat format, SeqList *sl) {
+    if (sizeof(size_t) != sizeof(uint64_t)) return;
+    // Rows served by a source that cannot be saved; nothing would be left to write
+    if (sl->source && !sl->source->save) return;
+    cache_wait();
+
+    CacheJob *job = calloc(1, sizeof(CacheJob));
+    if (!job) return;
+    job->path = strdup(path);
+    job->format = format;
+    job->sl = sl;
+    // Stamp before writing, so an edit made while we write leaves the cache stale
+    if (!job->path || cache_stamp(path, &job->stamp) != 0 ||
+        pthread_create(&writer_thread, NULL, writer_main, job) != 0) {
+        free(job->path);
+        free(job);
+        return;
+    }
+    writer_running = true;
+}
+
+void cache_wait(void) {
+    if (!writer_running) return;
+    pthread_join(writer_thread, NULL);
+    writer_running = false;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "parser.h"
+
+// Sidecar cache: <file>.showali keeps a parsed alignment in a layout that is mapped, not parsed.
+// It is tied to its source by size, modification time and a sampled content hash.
+
+// Open an alignment from the cache next to path; returns NULL when there is none or it is stale
+ParseResult *cache_load(const char *path);
+
+// Write the cache for a freshly parsed list on a background thread.
+// The list must stay alive and unchanged until cache_wait returns. Lists served by a source
+// that cannot save itself (lazy FASTA, .fai indexed FASTA) are not cached.
+void cache_save_async(const char *path, AlignmentFormat format, SeqList *sl);
+
+// Block until a pending background write has finished
+void cache_wait(void);
@@ -0,0 +1,303 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "faidx.h"
+#include "seqscan.h"
+
+// Helper function to build "<path><suffix>"
+static char *path_with_suffix(const char *path, const char *suffix) {
+    size_t len = strlen(path), extra = strlen(suffix);
+    char *out = malloc(len + extra + 1);
+    if (!out) return NULL;
+    memcpy(out, path, len);
+    memcpy(out + len, suffix, extra + 1);
+    return out;
+}
+
+// Helper function to append one record layout, growing the array as needed
+static int push_record(FaiRecord **recs, size_t *capacity, size_t count, FaiRecord rec) {
+    if (count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        FaiRecord *bigger = realloc(*recs, grown * sizeof(FaiRecord));
+        if (!bigger) return -1;
+        *recs = bigger;
+        *capacity = grown;
+    }
+    (*recs)[count] = rec;
+    return 0;
+}
+
+// Helper function to parse a tab followed by a decimal number from [*p, end)
+static int parse_field(const char **p, const char *end, uint64_t *value) {
+    const char *q = *p;
+    if (q >= end || *q != '\t') return -1;
+    q++;
+    if (q >= end || *q < '0' || *q > '9') return -1;
+    uint64_t v = 0;
+    while (q < end && *q >= '0' && *q <= '9') {
+        if (v > (UINT64_MAX - 9) / 10) return -1;
+        v = v * 10 + (uint64_t)(*q - '0');
+        q++;
+    }
+    *value = v;
+    *p = q;
+    return 0;
+}
+
+// Longest header line looked for behind a record of compressed text
+#define FAIDX_HEADER_LOOKBACK (64u << 10)
+// BGZF blocks inflated at a time while scanning compressed text
+#define FAIDX_SCAN_BLOCKS 256
+
+// Helper function to get the text of [offset, offset + n): mapped text in place, compressed text
+// inflated into buf, which must hold n bytes; NULL if it cannot be inflated
+static const char *text_at(const FaiText *text, uint64_t offset, size_t n, char *buf) {
+    if (!text->bgzf) return text->data + offset;
+    uint64_t voffset = bgzf_virtual_offset(text->bgzf->index, offset);
+    return bgzf_read(text->bgzf, voffset, n, buf) == n ? buf : NULL;
+}
+
+size_t faidx_record_bytes(const FaiRecord *rec, size_t len) {
+    if (len == 0) return 0;
+    return (len - 1) / rec->line_bases * rec->line_bytes + (len - 1) % rec->line_bases + 1;
+}
+
+void faidx_copy(const FaiRecord *rec, const FaiText *text, size_t start, size_t n, char *out) {
+    size_t col = start % rec->line_bases;
+    uint64_t line = rec->offset + start / rec->line_bases * rec->line_bytes;
+    while (n > 0) {
+        size_t take = rec->line_bases - col;
+        if (take > n) take = n;
+        const char *src = text_at(text, line + col, take, out);
+        if (!src) memset(out, '-', take);
+        else if (src != out) memcpy(out, src, take);
+        out += take;
+        n -= take;
+        line += rec->line_bytes;
+        col = 0;
+    }
+}
+
+FaiRecord *faidx_read(const char *path, const FaiText *text, SeqList *sl) {
+    char *fai_path = path_with_suffix(path, ".fai");
+    if (!fai_path) return NULL;
+
+    // An index older than the FASTA file may describe a previous version of it
+    struct stat fasta_st, fai_st;
+    MappedFile idx = { NULL, 0, false };
+    if (stat(path, &fasta_st) != 0 || stat(fai_path, &fai_st) != 0 ||
+        fai_st.st_mtime < fasta_st.st_mtime || mapped_file_open(&idx, fai_path) != 0) {
+        free(fai_path);
+        return NULL;
+    }
+    free(fai_path);
+
+    // Compressed text is only looked at around each record
+    char *lookback = text->bgzf ? malloc(FAIDX_HEADER_LOOKBACK) : NULL;
+    if (text->bgzf && !lookback) {
+        mapped_file_close(&idx);
+        return NULL;
+    }
+
+    FaiRecord *recs = NULL;
+    size_t capacity = 0;
+    const char *p = idx.data, *end = idx.data + idx.size;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *line_end = nl ? nl : end;
+        const char *next = nl ? nl + 1 : end;
+        if (line_end > p && line_end[-1] == '\r') line_end--;
+        if (line_end == p) {
+            p = next;
+            continue;
+        }
+
+        // name, length, offset, line bases, line bytes
+        const char *tab = memchr(p, '\t', line_end - p);
+        if (!tab || tab == p) goto broken;
+        size_t name_len = tab - p;
+        uint64_t len, offset, line_bases, line_bytes;
+        const char *q = tab;
+        if (parse_field(&q, line_end, &len) != 0 || parse_field(&q, line_end, &offset) != 0 ||
+            parse_field(&q, line_end, &line_bases) != 0 || parse_field(&q, line_end, &line_bytes) != 0) {
+            goto broken;
+        }
+
+        FaiRecord rec = { offset, (size_t)line_bases, (size_t)line_bytes };
+        if (len == 0 || line_bases == 0 || line_bytes < line_bases || offset < 2 || offset > text->size ||
+            faidx_record_bytes(&rec, len) > text->size - offset) {
+            goto broken;
+        }
+        // The record must end where a line ends
+        size_t after = offset + faidx_record_bytes(&rec, len);
+        char next_byte;
+        const char *after_at = after < text->size ? text_at(text, after, 1, &next_byte) : NULL;
+        if (after < text->size && (!after_at || (*after_at != '\n' && *after_at != '\r'))) goto broken;
+
+        // The line before the residues must be the record's header, named as in the index
+        size_t back = text->bgzf && offset > FAIDX_HEADER_LOOKBACK ? FAIDX_HEADER_LOOKBACK : offset;
+        const char *window = text_at(text, offset - back, back, lookback);
+        if (!window) goto broken;
+        const char *header_end = window + back - 1;
+        if (*header_end != '\n') goto broken;
+        if (header_end > window && header_end[-1] == '\r') header_end--;
+        const char *header = memrchr(window, '\n', header_end - window);
+        if (!header && back < offset) goto broken;
+        header = header ? header + 1 : window;
+        if (header >= header_end || *header != '>') goto broken;
+        const char *id = header + 1;
+        size_t id_len = header_end - id;
+        if (scan_find_space(id, id_len) != name_len || memcmp(id, p, name_len) != 0) goto broken;
+
+        long row = seqlist_add(sl, id, id_len);
+        if (row < 0 || push_record(&recs, &capacity, sl->count - 1, rec) != 0) goto broken;
+        sl->lens[row] = (size_t)len;
+        p = next;
+    }
+    if (sl->count == 0) goto broken;
+
+    free(lookback);
+    mapped_file_close(&idx);
+    return recs;
+
+broken:
+    free(recs);
+    free(lookback);
+    mapped_file_close(&idx);
+    return NULL;
+}
+
+// Where faidx_scan is between two stretches of text
+typedef struct {
+    FaiRecord *recs;
+    size_t     capacity;
+    FaiRecord *cur;
+    bool       last_line;  // the current record already had its short (or blank) line
+} FaiScan;
+
+// Helper function to index the lines of [p, end), which starts at text offset base. Unless final,
+// a last line without a line break is left for the next call; returns where indexing stopped,
+// or NULL if the records are irregular
+static const char *scan_lines(FaiScan *st, SeqList *sl, const char *p, const char *end, uint64_t base,
+                              bool final) {
+    const char *start = p;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (!nl && !final) break;
+        const char *next = nl ? nl + 1 : end;
+        size_t raw_len = next - p;
+        size_t line_len = scan_find_eol(p, raw_len);
+        // Offsets only work out when every line ends in exactly LF or CR LF
+        if (line_len < raw_len && line_len + 1 != raw_len &&
+            !(line_len + 2 == raw_len && p[line_len] == '\r')) {
+            return NULL;
+        }
+
+        if (scan_is_blank(p, line_len)) {
+            st->last_line = true;
+        } else if (p[0] == '>') {
+            if (line_len < 2 || (st->cur && sl->lens[sl->count - 1] == 0)) return NULL;
+            long row = seqlist_add(sl, p + 1, line_len - 1);
+            FaiRecord rec = { base + (uint64_t)(next - start), 0, 0 };
+            if (row < 0 || push_record(&st->recs, &st->capacity, (size_t)row, rec) != 0) return NULL;
+            st->cur = &st->recs[row];
+            st->last_line = false;
+        } else {
+            FaiRecord *cur = st->cur;
+            if (!cur || st->last_line || !scan_is_residue_text(p, line_len)) return NULL;
+            size_t *len = &sl->lens[sl->count - 1];
+            if (*len == 0) {
+                cur->line_bases = line_len;
+                cur->line_bytes = raw_len;
+            } else if (line_len > cur->line_bases) {
+                return NULL;
+            }
+            // Only the last line of a record may be shorter than the others
+            st->last_line = line_len != cur->line_bases || raw_len != cur->line_bytes;
+            *len += line_len;
+        }
+        p = next;
+    }
+    return p;
+}
+
+// Helper function to scan compressed text a batch of blocks at a time, carrying an unfinished
+// line over to the next batch; returns 0 on success, -1 if the records are irregular
+static int scan_bgzf(FaiScan *st, SeqList *sl, BgzfReader *rd) {
+    const BgzfIndex *idx = rd->index;
+    char *buf = NULL;
+    size_t held = 0;     // bytes of an unfinished line at the start of buf
+    uint64_t base = 0;   // text offset of buf[0]
+    int rc = 0;
+    for (size_t b = 0; b < idx->count && rc == 0; b += FAIDX_SCAN_BLOCKS) {
+        size_t last = b + FAIDX_SCAN_BLOCKS < idx->count ? b + FAIDX_SCAN_BLOCKS : idx->count;
+        size_t bytes = idx->uoffset[last] - idx->uoffset[b];
+        char *bigger = realloc(buf, held + bytes + 1);
+        if (!bigger || bgzf_inflate_blocks(rd->data, idx, b, last, bigger + held) != 0) {
+            buf = bigger ? bigger : buf;
+            rc = -1;
+            break;
+        }
+        buf = bigger;
+
+        // A line longer than the batch only grows until a line break turns up
+        bool final = last == idx->count;
+        if (!final && !memchr(buf + held, '\n', bytes)) {
+            held += bytes;
+            continue;
+        }
+        const char *stop = scan_lines(st, sl, buf, buf + held + bytes, base, final);
+        if (!stop) {
+            rc = -1;
+            break;
+        }
+        size_t used = stop - buf;
+        held = held + bytes - used;
+        memmove(buf, stop, held);
+        base += used;
+    }
+    free(buf);
+    return rc;
+}
+
+FaiRecord *faidx_scan(const FaiText *text, SeqList *sl) {
+    FaiScan st = { NULL, 0, NULL, false };
+    int rc = text->bgzf ? scan_bgzf(&st, sl, text->bgzf)
+                        : (scan_lines(&st, sl, text->data, text->data + text->size, 0, true) ? 0 : -1);
+    if (rc != 0 || !st.cur || sl->lens[sl->count - 1] == 0) {
+        free(st.recs);
+        return NULL;
+    }
+    return st.recs;
+}
+
+int faidx_write(const char *path, const SeqList *sl, const FaiRecord *recs) {
+    char *fai_path = path_with_suffix(path, ".fai");
+    char *tmp_path = path_with_suffix(path, ".fai.tmp");
+    FILE *out = fai_path && tmp_path ? fopen(tmp_path, "w") : NULL;
+    if (!out) {
+        free(fai_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    // Like samtools, name each record by the first word of its header
+    int failed = 0;
+    for (size_t i = 0; i < sl->count && !failed; i++) {
+        const char *id = sl->ids[i];
+        int name_len = (int)scan_find_space(id, strlen(id));
+        failed = fprintf(out, "%.*s\t%zu\t%llu\t%zu\t%zu\n", name_len, id, sl->lens[i],
+                         (unsigned long long)recs[i].offset, recs[i].line_bases, recs[i].line_bytes) < 0;
+    }
+    if (fclose(out) != 0) failed = 1;
+    if (failed || rename(tmp_path, fai_path) != 0) {
+        unlink(tmp_path);
+        failed = 1;
+    }
+    free(fai_path);
+    free(tmp_path);
+    return failed ? -1 : 0;
+}
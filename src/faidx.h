@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "bgzf.h"
+#include "seqlist.h"
+
+// Where one FASTA record sits in its file, as in a line of a samtools .fai index
+typedef struct {
+    uint64_t offset;      // byte offset of the record's first residue
+    size_t   line_bases;  // residues per full line
+    size_t   line_bytes;  // bytes per full line, line terminator included
+} FaiRecord;
+
+// Text of an indexed FASTA file: a plain mapping, or a BGZF file read block by block.
+// Record offsets always count bytes of the decompressed text, as samtools does
+typedef struct {
+    const char *data;  // the mapped text, or NULL when bgzf is set
+    size_t      size;  // bytes of (decompressed) text
+    BgzfReader *bgzf;
+} FaiText;
+
+// Load <path>.fai if it is at least as new as the FASTA file and matches its text.
+// Appends one row per record to the empty list sl (ids and lengths only) and returns the
+// record layouts, or NULL if there is no usable index (sl may then hold partial rows)
+FaiRecord *faidx_read(const char *path, const FaiText *text, SeqList *sl);
+
+// Build the index by scanning the text, with the same row contract as faidx_read.
+// Returns NULL if the file is not valid FASTA with regularly wrapped records
+FaiRecord *faidx_scan(const FaiText *text, SeqList *sl);
+
+// Save the index as <path>.fai; returns 0 on success, -1 on failure
+int faidx_write(const char *path, const SeqList *sl, const FaiRecord *recs);
+
+// Bytes the sequence lines of a record of len residues span in the file
+size_t faidx_record_bytes(const FaiRecord *rec, size_t len);
+
+// Copy residues [start, start + n) of a record out of the text; columns of compressed
+// text that cannot be inflated read as gaps
+void faidx_copy(const FaiRecord *rec, const FaiText *text, size_t start, size_t n, char *out);
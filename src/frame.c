@@ -0,0 +1,88 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame.h"
+
+// Helper function to make room for n more bytes; false when out of memory
+static bool reserve(Frame *f, size_t n) {
+    if (f->failed) return false;
+    if (f->capacity - f->size >= n) return true;
+
+    size_t capacity = f->capacity ? f->capacity : (64u << 10);
+    while (capacity - f->size < n) capacity *= 2;
+    char *data = realloc(f->data, capacity);
+    if (!data) {
+        f->failed = true;
+        return false;
+    }
+    f->data = data;
+    f->capacity = capacity;
+    return true;
+}
+
+void frame_reset(Frame *f) {
+    f->size = 0;
+    f->failed = false;
+}
+
+void frame_append(Frame *f, const char *s, size_t n) {
+    if (!reserve(f, n)) return;
+    memcpy(f->data + f->size, s, n);
+    f->size += n;
+}
+
+void frame_puts(Frame *f, const char *s) {
+    frame_append(f, s, strlen(s));
+}
+
+void frame_putc(Frame *f, char c) {
+    if (!reserve(f, 1)) return;
+    f->data[f->size++] = c;
+}
+
+void frame_fill(Frame *f, char c, size_t n) {
+    if (!reserve(f, n)) return;
+    memset(f->data + f->size, c, n);
+    f->size += n;
+}
+
+void frame_printf(Frame *f, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(f->data ? f->data + f->size : NULL, f->capacity - f->size, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+
+    // Format again once the text is known to fit
+    if ((size_t)n >= f->capacity - f->size) {
+        if (!reserve(f, (size_t)n + 1)) return;
+        va_start(ap, fmt);
+        vsnprintf(f->data + f->size, f->capacity - f->size, fmt, ap);
+        va_end(ap);
+    }
+    f->size += (size_t)n;
+}
+
+int frame_write(Frame *f, int fd) {
+    if (f->failed) return -1;
+    size_t sent = 0;
+    while (sent < f->size) {
+        ssize_t n = write(fd, f->data + sent, f->size - sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+    return 0;
+}
+
+void frame_free(Frame *f) {
+    free(f->data);
+    f->data = NULL;
+    f->size = f->capacity = 0;
+    f->failed = false;
+}
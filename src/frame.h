@@ -0,0 +1,29 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bytes of one screen update, composed in memory and sent to the terminal at once, so a frame
+// costs one system call instead of one stdio call per cell
+typedef struct {
+    char  *data;
+    size_t size;
+    size_t capacity;
+    bool   failed;  // out of memory: further appends are dropped and the frame is not sent
+} Frame;
+
+// Start composing a new frame, keeping the buffer of the last one
+void frame_reset(Frame *f);
+
+void frame_append(Frame *f, const char *s, size_t n);
+void frame_puts(Frame *f, const char *s);
+void frame_putc(Frame *f, char c);
+
+// Append c n times
+void frame_fill(Frame *f, char c, size_t n);
+
+void frame_printf(Frame *f, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Send the frame to fd, in one write unless the terminal takes it in parts; returns 0 on
+// success, -1 on a write error or when the frame could not be composed
+int  frame_write(Frame *f, int fd);
+void frame_free(Frame *f);
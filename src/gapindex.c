@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gapindex.h"
+#include "workpool.h"
+
+#define GAPINDEX_ROWS_PER_TASK 16
+
+size_t gapindex_find(const GapIndex *gi, size_t col) {
+    size_t lo = 0, hi = gi->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (gi->start[mid] + gi->length[mid] <= col) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool gapindex_is_gap(const GapIndex *gi, size_t col) {
+    size_t k = gapindex_find(gi, col);
+    return k < gi->count && gi->start[k] <= col;
+}
+
+size_t gapindex_next_residue(const GapIndex *gi, size_t col) {
+    size_t k = gapindex_find(gi, col);
+    // runs never touch, so the end of the run holding col is a residue (or the row end)
+    return k < gi->count && gi->start[k] <= col ? gi->start[k] + gi->length[k] : col;
+}
+
+size_t gapindex_residues_before(const GapIndex *gi, size_t col) {
+    size_t k = gapindex_find(gi, col);
+    size_t gaps = k < gi->count ? gi->before[k] : gi->total;
+    if (k < gi->count && gi->start[k] < col) gaps += col - gi->start[k];
+    return col - gaps;
+}
+
+GapIndex *gapindex_build(Arena *a, const size_t *start, const size_t *length, size_t count) {
+    GapIndex *gi = arena_alloc(a, sizeof(GapIndex));
+    if (!gi) return NULL;
+    gi->count = count;
+    gi->start = arena_alloc(a, count * sizeof(size_t));
+    gi->length = arena_alloc(a, count * sizeof(size_t));
+    gi->before = arena_alloc(a, count * sizeof(size_t));
+    if (!gi->start || !gi->length || !gi->before) return NULL;
+    memcpy(gi->start, start, count * sizeof(size_t));
+    memcpy(gi->length, length, count * sizeof(size_t));
+    gi->total = 0;
+    for (size_t k = 0; k < count; k++) {
+        gi->before[k] = gi->total;
+        gi->total += length[k];
+    }
+    return gi;
+}
+
+// What the survey pass learned about one row
+typedef struct {
+    size_t runs;  // number of gap runs
+    size_t gaps;  // gap columns
+    bool index;   // the row will be stored as residues plus runs
+} GapSurvey;
+
+typedef struct {
+    SeqList *sl;
+    GapSurvey *survey;
+    GapIndex **gaps;
+    char **stored;  // new home of every resident row (residues only for indexed rows)
+} GapJob;
+
+// Helper function to count the gap runs of each resident row
+static void survey_rows(size_t begin, size_t end, void *arg) {
+    GapJob *job = arg;
+    for (size_t i = begin; i < end; i++) {
+        const char *s = job->sl->seqs[i];
+        if (!s) continue;
+        size_t len = job->sl->lens[i];
+        GapSurvey *gs = &job->survey[i];
+        for (size_t k = 0; k < len; ) {
+            const char *dash = memchr(s + k, '-', len - k);
+            if (!dash) break;
+            size_t run = dash - s, stop = run;
+            while (stop < len && s[stop] == '-') stop++;
+            gs->runs++;
+            gs->gaps += stop - run;
+            k = stop;
+        }
+        // Worth it once gaps outweigh residues plus three words per run
+        gs->index = gs->gaps > len / 2 && gs->runs * 3 * sizeof(size_t) < gs->gaps / 2;
+    }
+}
+
+// Helper function to move each row into its new storage
+static void fill_rows(size_t begin, size_t end, void *arg) {
+    GapJob *job = arg;
+    for (size_t i = begin; i < end; i++) {
+        const char *s = job->sl->seqs[i];
+        if (!s) continue;
+        size_t len = job->sl->lens[i];
+        char *out = job->stored[i];
+        if (!job->survey[i].index) {
+            memcpy(out, s, len + 1);
+            continue;
+        }
+
+        GapIndex *gi = job->gaps[i];
+        size_t runs = 0, kept = 0, gaps = 0;
+        for (size_t k = 0; k < len; ) {
+            const char *dash = memchr(s + k, '-', len - k);
+            size_t run = dash ? (size_t)(dash - s) : len;
+            memcpy(out + kept, s + k, run - k);
+            kept += run - k;
+            if (!dash) break;
+            size_t stop = run;
+            while (stop < len && s[stop] == '-') stop++;
+            gi->start[runs] = run;
+            gi->length[runs] = stop - run;
+            gi->before[runs] = gaps;
+            gaps += stop - run;
+            runs++;
+            k = stop;
+        }
+        out[kept] = '\0';
+    }
+}
+
+void gapindex_list(SeqList *sl) {
+    if (sl->count == 0) return;
+
+    GapJob job = { sl, calloc(sl->count, sizeof(GapSurvey)),
+                   calloc(sl->capacity, sizeof(GapIndex *)), calloc(sl->count, sizeof(char *)) };
+    if (!job.survey || !job.gaps || !job.stored) goto done;
+
+    workpool_run(sl->count, GAPINDEX_ROWS_PER_TASK, survey_rows, &job);
+
+    size_t indexed = 0;
+    for (size_t i = 0; i < sl->count; i++) indexed += job.survey[i].index;
+    if (indexed == 0) goto done;
+
+    // Lay out the new storage serially, then fill it in parallel
+    Arena fresh;
+    arena_init(&fresh, sl->residues.chunk_size);
+    for (size_t i = 0; i < sl->count; i++) {
+        if (!sl->seqs[i]) continue;
+        GapSurvey *gs = &job.survey[i];
+        size_t keep = gs->index ? sl->lens[i] - gs->gaps : sl->lens[i];
+        job.stored[i] = arena_alloc(&fresh, keep + 1);
+        if (!job.stored[i]) goto out_of_memory;
+        if (!gs->index) continue;
+
+        GapIndex *gi = arena_alloc(&sl->meta, sizeof(GapIndex));
+        if (!gi) goto out_of_memory;
+        gi->count = gs->runs;
+        gi->total = gs->gaps;
+        gi->start = arena_alloc(&sl->meta, gs->runs * sizeof(size_t));
+        gi->length = arena_alloc(&sl->meta, gs->runs * sizeof(size_t));
+        gi->before = arena_alloc(&sl->meta, gs->runs * sizeof(size_t));
+        if (!gi->start || !gi->length || !gi->before) goto out_of_memory;
+        job.gaps[i] = gi;
+    }
+
+    workpool_run(sl->count, GAPINDEX_ROWS_PER_TASK, fill_rows, &job);
+
+    // Swap the new storage in and drop the old one
+    arena_free(&sl->residues);
+    sl->residues = fresh;
+    for (size_t i = 0; i < sl->count; i++) {
+        if (sl->seqs[i]) sl->seqs[i] = job.stored[i];
+    }
+    free(sl->gaps);
+    sl->gaps = job.gaps;
+    job.gaps = NULL;
+    goto done;
+
+out_of_memory:
+    // The index is only an optimization; keep the rows as they are (anything already
+    // placed in the meta arena is simply released with the list)
+    arena_free(&fresh);
+done:
+    free(job.survey);
+    free(job.gaps);
+    free(job.stored);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "seqlist.h"
+
+// Runs of '-' in one row, as sorted, non-adjacent column ranges
+struct GapIndex {
+    size_t  count;
+    size_t *start;   // first column of each run
+    size_t *length;  // columns in each run
+    size_t *before;  // gap columns in all earlier runs
+    size_t  total;   // gap columns in the row
+};
+
+// Index of the first run that ends after col (count if there is none)
+size_t gapindex_find(const GapIndex *gi, size_t col);
+
+// True if col falls inside a gap run
+bool gapindex_is_gap(const GapIndex *gi, size_t col);
+
+// First column at or after col that is not in a gap run
+size_t gapindex_next_residue(const GapIndex *gi, size_t col);
+
+// Number of non-gap columns before col
+size_t gapindex_residues_before(const GapIndex *gi, size_t col);
+
+// Build an index from run boundaries, copying them into the arena; returns NULL when out of memory
+GapIndex *gapindex_build(Arena *a, const size_t *start, const size_t *length, size_t count);
+
+// Store the list's gappy resident rows as their residues plus a gap index
+void gapindex_list(SeqList *sl);
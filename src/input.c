@@ -52,9 +52,13 @@ InputEvt input_read_timeout(int timeout_ms) {
         return (InputEvt){ .type = EVT_RESIZE };
     }
     
+    // A resize that lands after the check above still ends the wait
     fd_set rfds;
     FD_ZERO(&rfds);
     FD_SET(STDIN_FILENO, &rfds);
+    int wake_fd = resize_wakeup_fd();
+    if (wake_fd >= 0) FD_SET(wake_fd, &rfds);
+    int max_fd = wake_fd > STDIN_FILENO ? wake_fd : STDIN_FILENO;
     
     struct timeval timeout;
     struct timeval *timeout_ptr = NULL;
@@ -65,12 +69,15 @@ InputEvt input_read_timeout(int timeout_ms) {
         timeout_ptr = &timeout;
     }
     
-    int n = select(STDIN_FILENO+1, &rfds, NULL, NULL, timeout_ptr);
+    int n = select(max_fd + 1, &rfds, NULL, NULL, timeout_ptr);
     
     if (n == 0) {
         // Timeout occurred
         return (InputEvt){ .type = EVT_TIMEOUT };
     }
+    if (was_resized()) {
+        return (InputEvt){ .type = EVT_RESIZE };
+    }
 
     if (n > 0 && FD_ISSET(STDIN_FILENO, &rfds)) {
         char c;
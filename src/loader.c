@@ -0,0 +1,239 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "loader.h"
+#include "bgzf.h"
+#include "cache.h"
+
+// Bytes parsed up front for the preview; enough for the first screens of most alignments
+#define LOADER_PREVIEW_BYTES (4u << 20)
+
+struct Loader {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    char *path;
+    bool use_cache;
+    int fd;  // input streamed from a pipe, or -1 to load path
+
+    // Guarded by lock
+    ParseResult *preview;
+    ParseResult *result;
+    bool from_cache;
+    bool finished;
+};
+
+// Helper function to hand a preview over to the viewer
+static void publish_preview(Loader *ld, ParseResult *preview) {
+    if (!preview) return;
+    pthread_mutex_lock(&ld->lock);
+    ld->preview = preview;
+    pthread_mutex_unlock(&ld->lock);
+}
+
+// Helper function to load a file: its first bytes tell the format and give the preview, and
+// are all there is to parse when the file is short; longer files are then parsed in full
+static ParseResult *file_load(Loader *ld) {
+    MappedFile prefix;
+    if (mapped_file_read_prefix(&prefix, ld->path, LOADER_PREVIEW_BYTES) != 0) {
+        // Let the parser report why the file cannot be read
+        return parse_alignment(ld->path);
+    }
+
+    AlignmentFormat format = detect_format_prefix(prefix.data, prefix.size, ld->path);
+    if (prefix.size < LOADER_PREVIEW_BYTES) {
+        return parse_alignment_text(&prefix, ld->path, format);
+    }
+
+    ParseResult *preview = parse_alignment_preview(&prefix, ld->path, format);
+    if (preview && !preview->sequences) {
+        // The full parse would only repeat the same errors
+        return preview;
+    }
+    publish_preview(ld, preview);
+    parse_progress_report(0, 0);
+    return parse_alignment_with_format(ld->path, format);
+}
+
+// Input read from a pipe so far
+typedef struct {
+    char  *data;
+    size_t size;
+    size_t capacity;
+    bool   eof;
+} StreamBuffer;
+
+// Helper function to read from fd until the buffer holds want bytes or the input ends;
+// returns 0 on success, -1 on a read error or when out of memory
+static int stream_read(int fd, StreamBuffer *buf, size_t want) {
+    while (!buf->eof && buf->size < want) {
+        if (buf->size == buf->capacity) {
+            size_t capacity = buf->capacity ? buf->capacity * 2 : (1u << 20);
+            char *data = realloc(buf->data, capacity);
+            if (!data) return -1;
+            buf->data = data;
+            buf->capacity = capacity;
+        }
+        ssize_t n = read(fd, buf->data + buf->size, buf->capacity - buf->size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) buf->eof = true;
+        buf->size += (size_t)n;
+    }
+    return 0;
+}
+
+// Helper function to make a failed result
+static ParseResult *failed_result(const char *message) {
+    ParseResult *result = calloc(1, sizeof(ParseResult));
+    if (result) result->error_message = strdup(message);
+    return result;
+}
+
+// Helper function to load piped input: the first bytes tell the format and give the preview,
+// then the rest is read to the end and parsed as a whole
+static ParseResult *stream_load(Loader *ld) {
+    StreamBuffer buf = { NULL, 0, 0, false };
+    if (stream_read(ld->fd, &buf, LOADER_PREVIEW_BYTES) != 0) {
+        free(buf.data);
+        return failed_result("Cannot read input");
+    }
+
+    // Compressed input is only readable once it is all there
+    bool compressed = gzip_detect(buf.data, buf.size);
+    AlignmentFormat format = compressed ? FORMAT_UNKNOWN : detect_format_prefix(buf.data, buf.size, NULL);
+    if (!compressed && !buf.eof) {
+        // The preview takes over its text, while reading goes on into the buffer
+        char *copy = malloc(buf.size);
+        ParseResult *preview = NULL;
+        if (copy) {
+            memcpy(copy, buf.data, buf.size);
+            MappedFile prefix = { copy, buf.size, true };
+            preview = parse_alignment_preview(&prefix, ld->path, format);
+        }
+        if (preview && !preview->sequences) {
+            free(buf.data);
+            return preview;
+        }
+        publish_preview(ld, preview);
+    }
+
+    // The rest of a pipe has no known size to show progress against
+    parse_progress_report(0, 0);
+    if (stream_read(ld->fd, &buf, SIZE_MAX) != 0) {
+        free(buf.data);
+        return failed_result("Cannot read input");
+    }
+    MappedFile mf = { buf.data, buf.size, true };
+    if (compressed) {
+        if (gzip_inflate_file(&mf, SIZE_MAX) != 0) {
+            mapped_file_close(&mf);
+            return failed_result("Cannot decompress input");
+        }
+        format = detect_format_prefix(mf.data, mf.size, NULL);
+    }
+    return parse_alignment_text(&mf, ld->path, format);
+}
+
+static void *loader_main(void *arg) {
+    Loader *ld = arg;
+    ParseResult *result = ld->use_cache ? cache_load(ld->path) : NULL;
+    bool from_cache = result != NULL;
+
+    if (ld->fd >= 0) {
+        result = stream_load(ld);
+        close(ld->fd);
+    } else if (!result) {
+        result = file_load(ld);
+    }
+
+    pthread_mutex_lock(&ld->lock);
+    ld->result = result;
+    ld->from_cache = from_cache;
+    ld->finished = true;
+    pthread_cond_broadcast(&ld->done);
+    pthread_mutex_unlock(&ld->lock);
+    return NULL;
+}
+
+// Helper function to start the loader thread on a file, or on fd when it is not -1
+static Loader *start(const char *path, bool use_cache, int fd) {
+    Loader *ld = calloc(1, sizeof(Loader));
+    if (!ld) return NULL;
+    ld->path = strdup(path);
+    ld->use_cache = use_cache;
+    ld->fd = fd;
+    pthread_mutex_init(&ld->lock, NULL);
+    pthread_cond_init(&ld->done, NULL);
+    parse_progress_report(0, 0);
+
+    if (!ld->path || pthread_create(&ld->thread, NULL, loader_main, ld) != 0) {
+        pthread_cond_destroy(&ld->done);
+        pthread_mutex_destroy(&ld->lock);
+        free(ld->path);
+        free(ld);
+        return NULL;
+    }
+    return ld;
+}
+
+Loader *loader_start(const char *path, bool use_cache) {
+    return start(path, use_cache, -1);
+}
+
+Loader *loader_start_stream(int fd, const char *name) {
+    return start(name, false, fd);
+}
+
+bool loader_wait(Loader *ld, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&ld->lock);
+    while (!ld->finished) {
+        if (pthread_cond_timedwait(&ld->done, &ld->lock, &deadline) != 0) break;
+    }
+    bool finished = ld->finished;
+    pthread_mutex_unlock(&ld->lock);
+    return finished;
+}
+
+ParseResult *loader_take_preview(Loader *ld) {
+    pthread_mutex_lock(&ld->lock);
+    ParseResult *preview = ld->finished ? NULL : ld->preview;
+    if (preview) ld->preview = NULL;
+    pthread_mutex_unlock(&ld->lock);
+    return preview;
+}
+
+ParseResult *loader_take_result(Loader *ld, bool *from_cache) {
+    pthread_mutex_lock(&ld->lock);
+    ParseResult *result = ld->result;
+    ld->result = NULL;
+    if (from_cache) *from_cache = ld->from_cache;
+    pthread_mutex_unlock(&ld->lock);
+    return result;
+}
+
+void loader_free(Loader *ld) {
+    if (!ld) return;
+    pthread_join(ld->thread, NULL);
+    free_parse_result(ld->preview);
+    free_parse_result(ld->result);
+    pthread_cond_destroy(&ld->done);
+    pthread_mutex_destroy(&ld->lock);
+    free(ld->path);
+    free(ld);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdbool.h>
+#include "parser.h"
+
+// Loads an alignment on a background thread, so the viewer can start before parsing ends.
+// A quick preview of the first records is published first, then the full result
+typedef struct Loader Loader;
+
+// Start loading a file (from its sidecar cache first when use_cache); NULL if no thread could start
+Loader *loader_start(const char *path, bool use_cache);
+
+// Start loading input streamed from fd, such as a pipe, which the loader reads without seeking
+// and closes once read; name stands in for a file name. NULL if no thread could start (fd stays open)
+Loader *loader_start_stream(int fd, const char *name);
+
+// Wait up to timeout_ms for loading to finish; true once it has
+bool loader_wait(Loader *ld, int timeout_ms);
+
+// Take the preview once it is ready (NULL before that, after it was taken, or if there is none)
+ParseResult *loader_take_preview(Loader *ld);
+
+// Take the full result once loading has finished (NULL while it is still running);
+// from_cache tells whether it came from the sidecar cache
+ParseResult *loader_take_result(Loader *ld, bool *from_cache);
+
+// Join the thread and free the loader; only call once the result was taken
+void loader_free(Loader *ld);
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include "maf_tokenizer.h"
+#include "seqscan.h"
+
+void maf_tokenizer_init(MAFTokenizer *tk, const char *data, size_t size, size_t offset) {
+    tk->data = data;
+    tk->p = data + offset;
+    tk->end = data + size;
+    tk->line_num = 0;
+    tk->has_peek = false;
+    tk->stop = MAF_STOP_EOF;
+}
+
+// Helper function to skip field separators
+static const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+// Helper function to slice the next whitespace-delimited field
+static const char *next_field(const char *p, const char *end, const char **field, size_t *len) {
+    p = skip_blanks(p, end);
+    *len = scan_find_space(p, end - p);
+    *field = p;
+    return p + *len;
+}
+
+// Helper function to parse a non-negative decimal field by hand
+static bool parse_int64(const char *field, size_t len, int64_t *out) {
+    if (len == 0 || len > 18) return false;
+    int64_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (field[i] < '0' || field[i] > '9') return false;
+        v = v * 10 + (field[i] - '0');
+    }
+    *out = v;
+    return true;
+}
+
+// Helper function to split "s src start size strand srcSize text" in place
+static bool parse_seq_line(const char *p, const char *end, MAFSequence *seq) {
+    const char *f;
+    size_t len;
+
+    p = next_field(p + 1, end, &seq->species, &seq->species_len);
+    if (seq->species_len == 0) return false;
+    p = next_field(p, end, &f, &len);
+    if (!parse_int64(f, len, &seq->start)) return false;
+    p = next_field(p, end, &f, &len);
+    if (!parse_int64(f, len, &seq->size)) return false;
+    p = next_field(p, end, &f, &len);
+    if (len != 1) return false;
+    seq->strand = f[0];
+    p = next_field(p, end, &f, &len);
+    if (!parse_int64(f, len, &seq->src_size)) return false;
+    p = next_field(p, end, &seq->sequence, &seq->length);
+    return seq->length > 0;
+}
+
+// Helper function to tokenize the line at tk->p and advance past it
+static bool read_line(MAFTokenizer *tk, MAFLine *line) {
+    line->offset = tk->p - tk->data;
+    if (tk->p >= tk->end) {
+        line->kind = MAF_LINE_EOF;
+        line->line_num = tk->line_num;
+        return true;
+    }
+
+    const char *start = tk->p;
+    const char *nl = memchr(start, '\n', tk->end - start);
+    const char *stop = nl ? nl : tk->end;
+    tk->p = nl ? nl + 1 : tk->end;
+    line->line_num = ++tk->line_num;
+
+    // Strip CR of CRLF input and trailing blanks
+    while (stop > start && (stop[-1] == '\r' || stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+
+    if (scan_is_blank(start, stop - start)) {
+        line->kind = MAF_LINE_BLANK;
+    } else if (start[0] == '#') {
+        line->kind = MAF_LINE_COMMENT;
+    } else if (start[0] == 'a' && (stop - start == 1 || start[1] == ' ' || start[1] == '\t')) {
+        line->kind = MAF_LINE_ALIGN;
+    } else if (start[0] == 's' && stop - start > 1 && (start[1] == ' ' || start[1] == '\t')) {
+        line->kind = MAF_LINE_SEQ;
+        return parse_seq_line(start, stop, &line->seq);
+    } else {
+        line->kind = MAF_LINE_OTHER;
+    }
+    return true;
+}
+
+bool maf_next_line(MAFTokenizer *tk, MAFLine *line) {
+    if (tk->has_peek) {
+        tk->has_peek = false;
+        *line = tk->peeked;
+        return true;
+    }
+    return read_line(tk, line);
+}
+
+bool maf_peek_line(MAFTokenizer *tk, MAFLine *line) {
+    if (!tk->has_peek) {
+        if (!read_line(tk, &tk->peeked)) return false;
+        tk->has_peek = true;
+    }
+    *line = tk->peeked;
+    return true;
+}
+
+void free_maf_block(MAFBlock *block) {
+    if (!block) return;
+    free(block->sequences);
+    free(block);
+}
+
+MAFBlock *maf_read_block(MAFTokenizer *tk) {
+    MAFLine line;
+
+    // Skip to alignment header (line starting with 'a')
+    while (1) {
+        if (!maf_next_line(tk, &line)) {
+            tk->stop = MAF_STOP_MALFORMED;
+            return NULL;
+        }
+        if (line.kind == MAF_LINE_EOF) {
+            tk->stop = MAF_STOP_EOF;
+            return NULL;
+        }
+        
+        // Skip empty lines and comments
+        if (line.kind == MAF_LINE_BLANK || line.kind == MAF_LINE_COMMENT) continue;
+        
+        // Found alignment header
+        if (line.kind == MAF_LINE_ALIGN) break;
+        
+        // If we hit a line that doesn't start with 'a', this might not be MAF format
+        tk->stop = MAF_STOP_NOT_BLOCK;
+        return NULL;
+    }
+    
+    MAFBlock *block = calloc(1, sizeof(MAFBlock));
+    int sequences_capacity = 16;
+    if (block) block->sequences = malloc(sequences_capacity * sizeof(MAFSequence));
+    if (!block || !block->sequences) {
+        tk->stop = MAF_STOP_NO_MEMORY;
+        free_maf_block(block);
+        return NULL;
+    }
+    block->offset = line.offset;
+    
+    // Parse sequence lines until an empty line, the next block or the end of input
+    while (1) {
+        if (!maf_peek_line(tk, &line)) {
+            tk->stop = MAF_STOP_MALFORMED;
+            free_maf_block(block);
+            return NULL;
+        }
+        // The next block's header stays in the lookahead for the next call
+        if (line.kind == MAF_LINE_EOF || line.kind == MAF_LINE_ALIGN) break;
+        maf_next_line(tk, &line);
+        if (line.kind == MAF_LINE_BLANK) break;
+        
+        // Skip non-sequence lines
+        if (line.kind != MAF_LINE_SEQ) continue;
+        
+        // Expand sequences array if needed
+        if (block->sequence_count >= sequences_capacity) {
+            sequences_capacity *= 2;
+            MAFSequence *grown = realloc(block->sequences, sequences_capacity * sizeof(MAFSequence));
+            if (!grown) {
+                tk->stop = MAF_STOP_NO_MEMORY;
+                free_maf_block(block);
+                return NULL;
+            }
+            block->sequences = grown;
+        }
+        block->sequences[block->sequence_count++] = line.seq;
+        
+        // Update alignment length
+        if (line.seq.length > block->alignment_length) {
+            block->alignment_length = line.seq.length;
+        }
+    }
+    
+    if (block->sequence_count == 0) {
+        tk->stop = MAF_STOP_NOT_BLOCK;
+        free_maf_block(block);
+        return NULL;
+    }
+    
+    return block;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Kinds of lines in a MAF file
+typedef enum {
+    MAF_LINE_EOF,
+    MAF_LINE_BLANK,
+    MAF_LINE_COMMENT,   // '#' header or comment
+    MAF_LINE_ALIGN,     // 'a' block header
+    MAF_LINE_SEQ,       // 's' sequence line
+    MAF_LINE_OTHER      // 'i', 'e', 'q' and anything else inside a block
+} MAFLineKind;
+
+// One sequence line; text fields are slices of the input, not NUL-terminated
+typedef struct {
+    const char *species;
+    size_t      species_len;
+    int64_t     start;
+    int64_t     size;
+    char        strand;
+    int64_t     src_size;
+    const char *sequence;
+    size_t      length;
+} MAFSequence;
+
+// One tokenized line
+typedef struct {
+    MAFLineKind kind;
+    size_t      offset;    // byte offset of the line in the input
+    int         line_num;  // 1-based line number relative to where the tokenizer started
+    MAFSequence seq;       // filled for MAF_LINE_SEQ
+} MAFLine;
+
+// Why maf_read_block returned NULL
+typedef enum {
+    MAF_STOP_EOF,        // no more input
+    MAF_STOP_MALFORMED,  // a malformed 's' line, at the tokenizer's line_num
+    MAF_STOP_NOT_BLOCK,  // a line that starts no block, or a block without sequences
+    MAF_STOP_NO_MEMORY   // out of memory while reading a block
+} MAFStop;
+
+// Single forward pass over a mapped or buffered MAF text with one line of lookahead
+typedef struct {
+    const char *data;
+    const char *p;
+    const char *end;
+    int         line_num;
+    bool        has_peek;
+    MAFLine     peeked;
+    MAFStop     stop;      // set when maf_read_block returns NULL
+} MAFTokenizer;
+
+// A block of sequence lines; sequences point into the tokenizer input
+typedef struct {
+    size_t offset;          // byte offset of the block's 'a' line
+    MAFSequence *sequences;
+    int sequence_count;
+    size_t alignment_length;
+} MAFBlock;
+
+void maf_tokenizer_init(MAFTokenizer *tk, const char *data, size_t size, size_t offset);
+
+// Read the next line; returns false on a malformed 's' line (line->line_num tells where)
+bool maf_next_line(MAFTokenizer *tk, MAFLine *line);
+
+// Look at the next line without consuming it
+bool maf_peek_line(MAFTokenizer *tk, MAFLine *line);
+
+// Read the next alignment block; returns NULL at end of input or on malformed input (tk->stop tells which)
+MAFBlock *maf_read_block(MAFTokenizer *tk);
+void free_maf_block(MAFBlock *block);
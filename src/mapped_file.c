@@ -0,0 +1,100 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_file.h"
+#include "bgzf.h"
+
+int mapped_file_map(MappedFile *mf, const char *path) {
+    mf->data = NULL;
+    mf->size = 0;
+    mf->heap = false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // mmap() rejects zero-length mappings, an empty file is just an empty view
+    if (st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        // Parsers scan front to back, let the kernel read ahead aggressively
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+        mf->data = p;
+        mf->size = (size_t)st.st_size;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return 0;
+}
+
+int mapped_file_open(MappedFile *mf, const char *path) {
+    if (mapped_file_map(mf, path) != 0) return -1;
+    if (gzip_detect(mf->data, mf->size) && gzip_inflate_file(mf, SIZE_MAX) != 0) {
+        mapped_file_close(mf);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int mapped_file_read_prefix(MappedFile *mf, const char *path, size_t max_bytes) {
+    mf->data = NULL;
+    mf->size = 0;
+    mf->heap = true;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    char *buf = max_bytes ? malloc(max_bytes) : NULL;
+    size_t got = 0;
+    while (buf && got < max_bytes) {
+        ssize_t n = pread(fd, buf + got, max_bytes - got, (off_t)got);
+        if (n < 0) {
+            free(buf);
+            close(fd);
+            return -1;
+        }
+        if (n == 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+
+    mf->data = buf;
+    mf->size = got;
+
+    // Compressed input takes the whole file to get max_bytes of text
+    if (gzip_detect(mf->data, mf->size)) {
+        mapped_file_close(mf);
+        if (mapped_file_map(mf, path) != 0) return -1;
+        if (gzip_inflate_file(mf, max_bytes) != 0) {
+            mapped_file_close(mf);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void mapped_file_close(MappedFile *mf) {
+    if (mf->heap) {
+        free((void *)mf->data);
+    } else if (mf->data) {
+        munmap((void *)mf->data, mf->size);
+    }
+    mf->data = NULL;
+    mf->size = 0;
+    mf->heap = false;
+}
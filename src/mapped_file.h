@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Read-only memory mapping of a whole input file
+typedef struct {
+    const char *data;  // file contents (NULL for empty files)
+    size_t      size;  // file size in bytes
+    bool        heap;  // data is a malloc'd copy instead of a mapping
+} MappedFile;
+
+// Map a file read-only, inflating gzip and BGZF input into memory; returns 0 on success,
+// -1 on failure (errno is set)
+int  mapped_file_open(MappedFile *mf, const char *path);
+
+// Map a file read-only as stored, compressed or not; returns 0 on success, -1 on failure (errno is set)
+int  mapped_file_map(MappedFile *mf, const char *path);
+
+// Copy at most max_bytes from the start of a file (of its decompressed text if it is compressed)
+// into memory; returns 0 on success, -1 on failure. size may later be lowered to cut the copy short
+int  mapped_file_read_prefix(MappedFile *mf, const char *path, size_t max_bytes);
+void mapped_file_close(MappedFile *mf);
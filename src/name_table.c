@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <string.h>
+#include "name_table.h"
+
+// FNV-1a, good enough for short assembly/scaffold names
+static uint64_t hash_name(const char *name, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int name_table_init(NameTable *t) {
+    t->count = 0;
+    t->slots = calloc(64, sizeof(NameEntry));
+    t->capacity = t->slots ? 64 : 0;
+    return t->slots ? 0 : -1;
+}
+
+void name_table_free(NameTable *t) {
+    free(t->slots);
+    t->slots = NULL;
+    t->capacity = 0;
+    t->count = 0;
+}
+
+int name_table_find(const NameTable *t, const char *name, size_t len) {
+    if (t->capacity == 0) return -1;
+    uint64_t h = hash_name(name, len);
+    size_t mask = t->capacity - 1;
+    for (size_t i = h & mask; t->slots[i].key; i = (i + 1) & mask) {
+        const NameEntry *e = &t->slots[i];
+        if (e->hash == h && e->len == len && memcmp(e->key, name, len) == 0) {
+            return e->value;
+        }
+    }
+    return -1;
+}
+
+// Helper function to place an entry without checking the load factor
+static void place_entry(NameEntry *slots, size_t capacity, const NameEntry *e) {
+    size_t mask = capacity - 1;
+    size_t i = e->hash & mask;
+    while (slots[i].key) i = (i + 1) & mask;
+    slots[i] = *e;
+}
+
+int name_table_insert(NameTable *t, const char *name, size_t len, int value) {
+    // Keep the load factor under 1/2 so probe sequences stay short
+    if ((t->count + 1) * 2 > t->capacity) {
+        size_t new_capacity = t->capacity ? t->capacity * 2 : 64;
+        NameEntry *slots = calloc(new_capacity, sizeof(NameEntry));
+        if (!slots) return -1;
+        for (size_t i = 0; i < t->capacity; i++) {
+            if (t->slots[i].key) place_entry(slots, new_capacity, &t->slots[i]);
+        }
+        free(t->slots);
+        t->slots = slots;
+        t->capacity = new_capacity;
+    }
+
+    NameEntry e = { .hash = hash_name(name, len), .key = name, .len = len, .value = value };
+    place_entry(t->slots, t->capacity, &e);
+    t->count++;
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing hash table mapping sequence names to row indices.
+// Keys are borrowed: the caller keeps every inserted name alive for the table's lifetime.
+typedef struct {
+    uint64_t    hash;
+    const char *key;   // NULL marks an empty slot
+    size_t      len;
+    int         value;
+} NameEntry;
+
+typedef struct {
+    NameEntry *slots;
+    size_t     capacity;  // always a power of two
+    size_t     count;
+} NameTable;
+
+// Returns 0 on success, -1 when out of memory (the table is then empty and finds nothing)
+int  name_table_init(NameTable *t);
+void name_table_free(NameTable *t);
+
+// Look up a name of len bytes (not necessarily NUL-terminated); returns -1 if absent
+int  name_table_find(const NameTable *t, const char *name, size_t len);
+
+// Add a name that is known to be absent; returns 0 on success, -1 when out of memory
+// (the table is left as it was)
+int  name_table_insert(NameTable *t, const char *name, size_t len, int value);
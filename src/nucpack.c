@@ -0,0 +1,248 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nucpack.h"
+#include "workpool.h"
+
+#define NUCPACK_ROWS_PER_TASK 16
+
+// Code 0 marks an exception; code 5 is T or U depending on the row
+static const char code_chars[16] = {
+    0, '-', 'A', 'C', 'G', 'T', 'N', '.', 'R', 'Y', 'K', 'M', 'S', 'W', 'B', 'D'
+};
+
+#define CODE_PAIR(up, code) [up] = (code), [(up) | 0x20] = (code)
+
+// Byte to code for rows where code 5 means T; bytes left at 0 are exceptions
+static const unsigned char encode_t[256] = {
+    ['-'] = 1, ['.'] = 7,
+    CODE_PAIR('A', 2), CODE_PAIR('C', 3), CODE_PAIR('G', 4), CODE_PAIR('T', 5),
+    CODE_PAIR('N', 6), CODE_PAIR('R', 8), CODE_PAIR('Y', 9), CODE_PAIR('K', 10),
+    CODE_PAIR('M', 11), CODE_PAIR('S', 12), CODE_PAIR('W', 13), CODE_PAIR('B', 14),
+    CODE_PAIR('D', 15)
+};
+
+#undef CODE_PAIR
+
+// Survey classes of a byte
+enum {
+    SURVEY_T = 1 << 0,
+    SURVEY_U = 1 << 1,
+    SURVEY_NO_CODE = 1 << 2,  // an exception whichever way code 5 is read
+    SURVEY_LOWER = 1 << 3
+};
+
+// Two decoded columns per packed byte, and the code of every byte, one table per reading of code 5
+static uint16_t decode_pairs[2][256];
+static unsigned char encode_codes[2][256];
+static unsigned char survey_class[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (int u = 0; u < 2; u++) {
+        for (int b = 0; b < 256; b++) {
+            char lo = code_chars[b & 15], hi = code_chars[b >> 4];
+            if (u && lo == 'T') lo = 'U';
+            if (u && hi == 'T') hi = 'U';
+            unsigned char pair[2] = { (unsigned char)lo, (unsigned char)hi };
+            memcpy(&decode_pairs[u][b], pair, 2);
+
+            unsigned folded = b & 0xDF;
+            if (folded == 'U') encode_codes[u][b] = u ? 5 : 0;
+            else if (folded == 'T' && u) encode_codes[u][b] = 0;
+            else encode_codes[u][b] = encode_t[b];
+        }
+    }
+    for (int b = 0; b < 256; b++) {
+        unsigned folded = b & 0xDF;
+        survey_class[b] = (folded == 'T' ? SURVEY_T : 0) | (folded == 'U' ? SURVEY_U : 0) |
+                          (encode_t[b] == 0 && folded != 'U' ? SURVEY_NO_CODE : 0) |
+                          (b >= 'a' && b <= 'z' ? SURVEY_LOWER : 0);
+    }
+}
+
+void nucpack_decode(const PackedRow *pr, size_t start, size_t n, char *out) {
+    pthread_once(&tables_once, build_tables);
+    const uint16_t *pairs = decode_pairs[pr->t_is_u];
+
+    size_t i = 0;
+    char pair[2];
+    if ((start & 1) && n > 0) {
+        // the window opens on the high half of a byte
+        memcpy(pair, &pairs[pr->codes[start >> 1]], 2);
+        out[i++] = pair[1];
+    }
+    // Whole bytes decode two columns at a time
+    const unsigned char *codes = pr->codes + ((start + i) >> 1);
+    for (; i + 1 < n; i += 2) {
+        memcpy(out + i, &pairs[*codes++], 2);
+    }
+    if (i < n) {
+        memcpy(pair, &pairs[*codes], 2);
+        out[i] = pair[0];
+    }
+
+    // Soft-masked columns are lowercase
+    if (pr->mask) {
+        for (size_t k = 0; k < n; k++) {
+            size_t col = start + k;
+            if (pr->mask[col >> 6] >> (col & 63) & 1) out[k] |= 0x20;
+        }
+    }
+
+    // Patch the exceptions inside the window
+    size_t lo = 0, hi = pr->exc_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pr->exc_pos[mid] < start) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < pr->exc_count && pr->exc_pos[lo] < start + n; lo++) {
+        out[pr->exc_pos[lo] - start] = pr->exc_chr[lo];
+    }
+}
+
+// What the survey pass learned about one row
+typedef struct {
+    size_t exceptions;  // bytes without a code, given the chosen T/U reading
+    bool t_is_u;
+    bool has_lower;
+    bool pack;          // the row will be packed
+} RowSurvey;
+
+typedef struct {
+    SeqList *sl;
+    RowSurvey *survey;
+    PackedRow **packed;
+    char **plain;       // new home of rows that stay unpacked
+} PackJob;
+
+// Helper function to count what packing a row would cost
+static void survey_rows(size_t begin, size_t end, void *arg) {
+    PackJob *job = arg;
+    for (size_t i = begin; i < end; i++) {
+        RowSurvey *rs = &job->survey[i];
+        const unsigned char *s = (const unsigned char *)job->sl->seqs[i];
+        SequenceType type = job->sl->types[i];
+        if (!s || (type != SEQ_DNA && type != SEQ_RNA)) continue;
+
+        size_t len = seqlist_stored_len(job->sl, i);
+        size_t t = 0, u = 0, other = 0;
+        unsigned seen = 0;
+        for (size_t k = 0; k < len; k++) {
+            unsigned cls = survey_class[s[k]];
+            t += cls & SURVEY_T;
+            u += (cls & SURVEY_U) >> 1;
+            other += (cls & SURVEY_NO_CODE) >> 2;
+            seen |= cls;
+        }
+        rs->t_is_u = u > t;
+        rs->exceptions = other + (rs->t_is_u ? t : u);
+        rs->has_lower = (seen & SURVEY_LOWER) != 0;
+        // Only pack when it saves at least a quarter of the row, counting bookkeeping and exceptions
+        size_t packed_size = sizeof(PackedRow) + 64 + (len + 1) / 2 +
+                             (rs->has_lower ? (len + 63) / 64 * sizeof(uint64_t) : 0) +
+                             rs->exceptions * (sizeof(size_t) + 1);
+        rs->pack = packed_size * 4 < (len + 1) * 3;
+    }
+}
+
+// Helper function to fill the new storage of each row
+static void encode_rows(size_t begin, size_t end, void *arg) {
+    PackJob *job = arg;
+    for (size_t i = begin; i < end; i++) {
+        const unsigned char *s = (const unsigned char *)job->sl->seqs[i];
+        size_t len = seqlist_stored_len(job->sl, i);
+        if (!s) continue;
+
+        if (!job->survey[i].pack) {
+            memcpy(job->plain[i], s, len + 1);
+            continue;
+        }
+
+        PackedRow *pr = job->packed[i];
+        const unsigned char *enc = encode_codes[pr->t_is_u];
+        // Two columns per byte; the rare exceptions are picked up in column order
+        size_t exc = 0;
+        for (size_t k = 0; k < len; k += 2) {
+            unsigned lo = enc[s[k]];
+            unsigned hi = k + 1 < len ? enc[s[k + 1]] : 1;
+            pr->codes[k >> 1] = (unsigned char)(lo | hi << 4);
+            if (lo && hi) continue;
+            for (size_t j = k; j < k + 2 && j < len; j++) {
+                if (enc[s[j]]) continue;
+                pr->exc_pos[exc] = j;
+                pr->exc_chr[exc] = (char)s[j];
+                exc++;
+            }
+        }
+        if (!pr->mask) continue;
+        for (size_t k = 0; k < len; k++) {
+            unsigned char c = s[k];
+            if ((unsigned)(c - 'a') <= 'z' - 'a' && enc[c]) pr->mask[k >> 6] |= (uint64_t)1 << (k & 63);
+        }
+    }
+}
+
+void nucpack_list(SeqList *sl) {
+    if (sl->count == 0) return;
+    pthread_once(&tables_once, build_tables);
+
+    PackJob job = { sl, calloc(sl->count, sizeof(RowSurvey)),
+                    calloc(sl->capacity, sizeof(PackedRow *)), calloc(sl->count, sizeof(char *)) };
+    if (!job.survey || !job.packed || !job.plain) goto done;
+
+    workpool_run(sl->count, NUCPACK_ROWS_PER_TASK, survey_rows, &job);
+
+    size_t packable = 0;
+    for (size_t i = 0; i < sl->count; i++) packable += job.survey[i].pack;
+    if (packable == 0) goto done;
+
+    // Lay out the new storage serially, then fill it in parallel
+    Arena fresh;
+    arena_init(&fresh, sl->residues.chunk_size);
+    for (size_t i = 0; i < sl->count; i++) {
+        if (!sl->seqs[i]) continue;
+        size_t len = seqlist_stored_len(sl, i);
+        RowSurvey *rs = &job.survey[i];
+        if (!rs->pack) {
+            job.plain[i] = arena_alloc(&fresh, len + 1);
+            if (!job.plain[i]) goto out_of_memory;
+            continue;
+        }
+
+        PackedRow *pr = arena_alloc(&fresh, sizeof(PackedRow));
+        if (!pr) goto out_of_memory;
+        pr->codes = arena_alloc(&fresh, (len + 1) / 2);
+        pr->mask = rs->has_lower ? arena_alloc(&fresh, (len + 63) / 64 * sizeof(uint64_t)) : NULL;
+        pr->exc_pos = rs->exceptions ? arena_alloc(&fresh, rs->exceptions * sizeof(size_t)) : NULL;
+        pr->exc_chr = rs->exceptions ? arena_alloc(&fresh, rs->exceptions) : NULL;
+        if (!pr->codes || (rs->has_lower && !pr->mask) ||
+            (rs->exceptions && (!pr->exc_pos || !pr->exc_chr))) goto out_of_memory;
+        if (pr->mask) memset(pr->mask, 0, (len + 63) / 64 * sizeof(uint64_t));
+        pr->exc_count = rs->exceptions;
+        pr->t_is_u = rs->t_is_u;
+        job.packed[i] = pr;
+    }
+
+    workpool_run(sl->count, NUCPACK_ROWS_PER_TASK, encode_rows, &job);
+
+    // Swap the new storage in and drop the old one
+    arena_free(&sl->residues);
+    sl->residues = fresh;
+    for (size_t i = 0; i < sl->count; i++) {
+        if (sl->seqs[i]) sl->seqs[i] = job.plain[i];
+    }
+    free(sl->packed);
+    sl->packed = job.packed;
+    job.packed = NULL;
+    goto done;
+
+out_of_memory:
+    // Packing is only an optimization; keep the rows as they are
+    arena_free(&fresh);
+done:
+    free(job.survey);
+    free(job.packed);
+    free(job.plain);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "seqlist.h"
+
+// Nucleotide row stored as 4-bit codes, two columns per byte.
+// Case lives in a separate soft-mask bitmap; bytes without a code are kept in an exception list.
+struct PackedRow {
+    unsigned char *codes;
+    uint64_t *mask;        // bit set for lowercase columns, NULL when the row has none
+    size_t *exc_pos;       // ascending columns holding an exception
+    char   *exc_chr;       // the residue at each of those columns
+    size_t  exc_count;
+    bool    t_is_u;        // the T/U code reads as 'U' in this row
+};
+
+// Repack the list's resident DNA/RNA rows; rows with many uncodable bytes stay as they are
+void nucpack_list(SeqList *sl);
+
+// Decode columns [start, start + n) of a packed row into out
+void nucpack_decode(const PackedRow *pr, size_t start, size_t n, char *out);
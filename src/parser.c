@@ -2,175 +2,181 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdatomic.h>
 #include <strings.h>
+#include <stdbool.h>
 #include "parser.h"
+#include "seqscan.h"
 
-// Helper function to read first few lines of a file for format detection
-static char **read_file_lines(const char *filename, int max_lines, int *lines_read) {
-    FILE *f = fopen(filename, "r");
-    if (!f) {
-        *lines_read = 0;
-        return NULL;
-    }
+// Lines of the prefix looked at for format detection
+#define DETECT_LINES 10
 
-    char **lines = calloc(max_lines, sizeof(char*));
-    char *line = NULL;
-    size_t len = 0;
-    int count = 0;
+// Progress of the parse in flight, published for a loader to poll
+static atomic_size_t progress_done, progress_total;
 
-    while (count < max_lines && getline(&line, &len, f) != -1) {
-        // Remove trailing newline
-        size_t line_len = strlen(line);
-        if (line_len > 0 && line[line_len - 1] == '\n') {
-            line[line_len - 1] = '\0';
-        }
-        if (line_len > 1 && line[line_len - 2] == '\r') {
-            line[line_len - 2] = '\0';
-        }
-        
-        lines[count] = strdup(line);
-        count++;
+void parse_progress_report(size_t done, size_t total) {
+    atomic_store(&progress_total, total);
+    atomic_store(&progress_done, done);
+}
+
+int parse_progress_percent(void) {
+    size_t total = atomic_load(&progress_total);
+    size_t done = atomic_load(&progress_done);
+    if (total == 0) return -1;
+    return done >= total ? 100 : (int)(done * 100 / total);
+}
+
+// Helper function to find the extension of a file name, looking past a compression suffix
+// as in "chr1.fa.gz"; the inner extension is copied into buf. NULL if there is none
+static const char *file_extension(const char *filename, char *buf, size_t buf_size) {
+    const char *ext = strrchr(filename, '.');
+    if (!ext) return NULL;
+    if (strcasecmp(ext, ".gz") != 0 && strcasecmp(ext, ".bgz") != 0) return ext + 1;
+
+    const char *inner = ext;
+    while (inner > filename && inner[-1] != '.' && inner[-1] != '/') inner--;
+    size_t len = ext - inner;
+    if (inner == filename || inner[-1] != '.' || len >= buf_size) return NULL;
+    memcpy(buf, inner, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+// Helper function to tell the format a file name suggests
+static AlignmentFormat format_from_extension(const char *filename) {
+    char inner_ext[16];
+    const char *ext = filename ? file_extension(filename, inner_ext, sizeof(inner_ext)) : NULL;
+    if (!ext) return FORMAT_UNKNOWN;
+    if (strcasecmp(ext, "fasta") == 0 || strcasecmp(ext, "fa") == 0 ||
+        strcasecmp(ext, "fas") == 0 || strcasecmp(ext, "fna") == 0) {
+        return FORMAT_FASTA;
     }
+    if (strcasecmp(ext, "phy") == 0 || strcasecmp(ext, "phylip") == 0) return FORMAT_PHY;
+    if (strcasecmp(ext, "maf") == 0) return FORMAT_MAF;
+    if (strcasecmp(ext, "aln") == 0 || strcasecmp(ext, "clustal") == 0) return FORMAT_ALN;
+    return FORMAT_UNKNOWN;
+}
 
-    free(line);
-    fclose(f);
-    *lines_read = count;
-    return lines;
+// Helper function to find the line at p: sets *len to its length without the line break
+// and returns where the next line starts
+static const char *next_line(const char *p, const char *end, size_t *len) {
+    const char *nl = memchr(p, '\n', end - p);
+    const char *stop = nl ? nl : end;
+    *len = stop - p;
+    if (*len > 0 && p[*len - 1] == '\r') (*len)--;
+    return nl ? nl + 1 : end;
 }
 
-// Helper function to free lines array
-static void free_lines(char **lines, int count) {
-    if (!lines) return;
-    for (int i = 0; i < count; i++) {
-        free(lines[i]);
+// Helper function to count the whitespace separated fields of a line; rest is set to where
+// the second field starts (the end of the line if there is none)
+static int count_fields(const char *line, size_t len, const char **rest) {
+    int fields = 0;
+    *rest = line + len;
+    for (size_t i = 0; i < len; ) {
+        while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i == len) break;
+        if (++fields == 2) *rest = line + i;
+        while (i < len && line[i] != ' ' && line[i] != '\t') i++;
     }
-    free(lines);
+    return fields;
 }
 
-// Helper function to check if a string looks like a sequence (DNA/RNA/Protein)
-static int looks_like_sequence(const char *line) {
-    if (!line || strlen(line) == 0) return 0;
-    
-    int valid_chars = 0;
-    int total_chars = 0;
-    
-    for (size_t i = 0; i < strlen(line); i++) {
-        char c = toupper(line[i]);
-        if (isalpha(c) || c == '-' || c == '.' || c == 'N' || c == 'X' || c == '*') {
-            valid_chars++;
-        }
-        if (!isspace(c)) {
-            total_chars++;
+// Helper function to check if a line is two positive counts, as a PHYLIP header is
+static bool is_count_pair(const char *line, size_t len) {
+    int counts = 0;
+    for (size_t i = 0; i < len; ) {
+        while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i == len) break;
+        bool positive = false;
+        for (; i < len && line[i] != ' ' && line[i] != '\t'; i++) {
+            if (line[i] < '0' || line[i] > '9') return false;
+            positive |= line[i] != '0';
         }
+        if (!positive) return false;
+        counts++;
     }
+    return counts == 2;
+}
+
+// Helper function to check if text looks like a sequence (DNA/RNA/Protein)
+static bool looks_like_sequence(const char *text, size_t len) {
+    ResidueCounts rc = {0};
+    scan_count_residues(text, len, &rc);
+    
+    size_t valid_chars = rc.letters + rc.gaps + rc.stops;
+    size_t total_chars = rc.bytes - rc.space;
     
     // At least 70% of non-space characters should be valid sequence characters
     return total_chars > 0 && (valid_chars * 100 / total_chars) >= 70;
 }
 
-// Auto-detection logic
-AlignmentFormat detect_format(const char *filename) {
-    if (!filename) return FORMAT_UNKNOWN;
-    
-    // First, check file extension as a hint
-    const char *ext = strrchr(filename, '.');
-    if (ext) {
-        ext++; // Skip the dot
-        if (strcasecmp(ext, "fasta") == 0 || strcasecmp(ext, "fa") == 0 || 
-            strcasecmp(ext, "fas") == 0 || strcasecmp(ext, "fna") == 0) {
-            return FORMAT_FASTA;
-        }
-        if (strcasecmp(ext, "phy") == 0 || strcasecmp(ext, "phylip") == 0) {
-            return FORMAT_PHY;
-        }
-        if (strcasecmp(ext, "maf") == 0) {
-            return FORMAT_MAF;
-        }
-        if (strcasecmp(ext, "aln") == 0 || strcasecmp(ext, "clustal") == 0) {
-            return FORMAT_ALN;
-        }
-    }
-    
-    // Read first few lines to analyze content
-    int lines_read;
-    char **lines = read_file_lines(filename, 10, &lines_read);
-    
-    if (!lines || lines_read == 0) {
-        free_lines(lines, lines_read);
-        return FORMAT_UNKNOWN;
+// Helper function to score a line as a MAF record: "a" opens a block, and s/i/e/q lines
+// carry a fixed number of fields
+static int maf_line_score(const char *line, size_t len) {
+    if (len == 0 || (len > 1 && line[1] != ' ' && line[1] != '\t')) return 0;
+    const char *rest;
+    int fields = count_fields(line, len, &rest);
+    switch (line[0]) {
+        case 'a': return 1;
+        case 's': return fields == 7 ? 2 : 0;
+        case 'i': return fields == 6 ? 2 : 0;
+        case 'e': return fields == 7 ? 2 : 0;
+        case 'q': return fields == 3 ? 2 : 0;
+        default: return 0;
     }
-    
-    // Check for FASTA format (starts with >)
-    if (lines[0] && lines[0][0] == '>') {
-        free_lines(lines, lines_read);
-        return FORMAT_FASTA;
-    }
-    
-    // Check for ALN/Clustal format (starts with CLUSTAL)
-    if (lines[0] && strncasecmp(lines[0], "CLUSTAL", 7) == 0) {
-        free_lines(lines, lines_read);
-        return FORMAT_ALN;
-    }
-    
-    // Check for MAF format (starts with ##maf or has alignment blocks)
-    if (lines[0] && strncmp(lines[0], "##maf", 5) == 0) {
-        free_lines(lines, lines_read);
-        return FORMAT_MAF;
-    }
-    
-    // Look for MAF alignment blocks (lines starting with 'a', 's', etc.)
-    for (int i = 0; i < lines_read; i++) {
-        if (lines[i] && strlen(lines[i]) > 0) {
-            char first_char = lines[i][0];
-            if (first_char == 'a' || first_char == 's' || first_char == 'i' || first_char == 'e' || first_char == 'q') {
-                // Check if this looks like MAF format
-                char *space_pos = strchr(lines[i], ' ');
-                if (space_pos && space_pos > lines[i] && space_pos[1] != '\0') {
-                    free_lines(lines, lines_read);
-                    return FORMAT_MAF;
-                }
+}
+
+AlignmentFormat detect_format_prefix(const char *data, size_t size, const char *filename) {
+    // Evidence for each format from the first lines, in one pass; a header line settles it,
+    // records add up, and the file name only breaks ties
+    int score[FORMAT_ALN + 1] = {0};
+    AlignmentFormat hint = format_from_extension(filename);
+    if (hint != FORMAT_UNKNOWN) score[hint] += 1;
+
+    const char *p = data, *end = data + size;
+    const char *first = NULL;
+    size_t first_len = 0;
+    for (int lines = 0; p < end && lines < DETECT_LINES; ) {
+        size_t len;
+        const char *line = p;
+        p = next_line(p, end, &len);
+        if (len == 0) continue;
+        lines++;
+
+        if (!first) {
+            first = line;
+            first_len = len;
+            if (line[0] == '>') score[FORMAT_FASTA] += 4;
+            if (len >= 7 && strncasecmp(line, "CLUSTAL", 7) == 0) score[FORMAT_ALN] += 4;
+            if (len >= 5 && strncmp(line, "##maf", 5) == 0) score[FORMAT_MAF] += 4;
+        } else if (lines == 2 && is_count_pair(first, first_len)) {
+            // A PHYLIP header is followed by a name and the start of its sequence
+            const char *rest;
+            if (count_fields(line, len, &rest) >= 2 && looks_like_sequence(rest, line + len - rest)) {
+                score[FORMAT_PHY] += 4;
             }
         }
+        score[FORMAT_MAF] += maf_line_score(line, len);
     }
-    
-    // Check for PHY format (first line should be two numbers: num_sequences num_sites)
-    if (lines[0] && strlen(lines[0]) > 0) {
-        // Try to parse first line as two integers
-        char *line_copy = strdup(lines[0]);
-        char *token1 = strtok(line_copy, " \t");
-        char *token2 = strtok(NULL, " \t");
-        char *token3 = strtok(NULL, " \t");
-        
-        if (token1 && token2 && !token3) {
-            // Check if both tokens are numbers
-            char *endptr1, *endptr2;
-            long num1 = strtol(token1, &endptr1, 10);
-            long num2 = strtol(token2, &endptr2, 10);
-            
-            if (*endptr1 == '\0' && *endptr2 == '\0' && num1 > 0 && num2 > 0) {
-                // First line looks like PHY format header
-                // Check if subsequent lines look like sequences
-                if (lines_read > 1 && lines[1] && strlen(lines[1]) > 0) {
-                    // Check if second line has a name followed by sequence data
-                    char *line2_copy = strdup(lines[1]);
-                    char *name = strtok(line2_copy, " \t");
-                    char *seq_data = strtok(NULL, "");
-                    
-                    if (name && seq_data && looks_like_sequence(seq_data)) {
-                        free(line2_copy);
-                        free(line_copy);
-                        free_lines(lines, lines_read);
-                        return FORMAT_PHY;
-                    }
-                    free(line2_copy);
-                }
-            }
-        }
-        free(line_copy);
+
+    AlignmentFormat best = hint;
+    for (int f = FORMAT_FASTA; f <= FORMAT_ALN; f++) {
+        if (score[f] > score[best]) best = (AlignmentFormat)f;
     }
-    
-    free_lines(lines, lines_read);
-    return FORMAT_UNKNOWN;
+    return score[best] > 0 ? best : FORMAT_UNKNOWN;
+}
+
+// Auto-detection logic
+AlignmentFormat detect_format(const char *filename) {
+    if (!filename) return FORMAT_UNKNOWN;
+
+    MappedFile prefix;
+    if (mapped_file_read_prefix(&prefix, filename, DETECT_PREFIX_BYTES) != 0) {
+        return format_from_extension(filename);
+    }
+    AlignmentFormat format = detect_format_prefix(prefix.data, prefix.size, filename);
+    mapped_file_close(&prefix);
+    return format;
 }
 
 // Main parsing function with auto-detection
@@ -223,20 +229,68 @@ ParseResult *parse_alignment_with_format(const char *filename, AlignmentFormat f
     return result;
 }
 
+// Helper function to find where a prefix must be cut so it ends with a whole record; 0 if it cannot
+static size_t preview_cut(const char *data, size_t size, AlignmentFormat format) {
+    // Records start at a line opening with this byte
+    char opener = format == FORMAT_FASTA ? '>' : 'a';
+    for (size_t k = size; k-- > 1; ) {
+        if (data[k] == opener && data[k - 1] == '\n') return k;
+    }
+    // A FASTA record longer than the prefix is still worth showing in part
+    return format == FORMAT_FASTA ? size : 0;
+}
+
+// Helper function to get the message for a parse that failed in a given format
+static const char *failure_message(AlignmentFormat format) {
+    switch (format) {
+        case FORMAT_FASTA: return "Failed to parse FASTA file";
+        case FORMAT_PHY: return "Failed to parse PHY file";
+        case FORMAT_MAF: return "Failed to parse MAF file";
+        case FORMAT_ALN: return "Failed to parse ALN file";
+        default: return "Unknown or unsupported file format";
+    }
+}
+
+ParseResult *parse_alignment_text(MappedFile *input, const char *name, AlignmentFormat format) {
+    ParseResult *result = calloc(1, sizeof(ParseResult));
+    result->format = format;
+    switch (format) {
+        case FORMAT_FASTA: result->sequences = parse_fasta_loaded(input, name); break;
+        case FORMAT_PHY: result->sequences = parse_phy_mapped(input, name); break;
+        case FORMAT_MAF: result->sequences = parse_maf_mapped(input, name); break;
+        case FORMAT_ALN: result->sequences = parse_aln_mapped(input, name); break;
+        default: break;
+    }
+    mapped_file_close(input);
+    if (!result->sequences) result->error_message = strdup(failure_message(format));
+    return result;
+}
+
+ParseResult *parse_alignment_preview(MappedFile *prefix, const char *name, AlignmentFormat format) {
+    // Interleaved formats spread every row over the whole file
+    prefix->size = format == FORMAT_FASTA || format == FORMAT_MAF
+                 ? preview_cut(prefix->data, prefix->size, format) : 0;
+    if (prefix->size == 0) {
+        mapped_file_close(prefix);
+        return NULL;
+    }
+
+    ParseResult *result = calloc(1, sizeof(ParseResult));
+    result->format = format;
+    result->sequences = format == FORMAT_FASTA ? parse_fasta_mapped(prefix, name)
+                                               : parse_maf_mapped(prefix, name);
+    mapped_file_close(prefix);
+    if (!result->sequences) {
+        result->error_message = strdup(failure_message(format));
+    }
+    return result;
+}
+
 // Free parse result
 void free_parse_result(ParseResult *result) {
     if (!result) return;
     
-    if (result->sequences) {
-        // Free sequences (assuming the existing SeqList has proper cleanup)
-        for (size_t i = 0; i < result->sequences->count; i++) {
-            free(result->sequences->items[i].id);
-            free(result->sequences->items[i].seq);
-        }
-        free(result->sequences->items);
-        free(result->sequences);
-    }
-    
+    seqlist_free(result->sequences);
     free(result->error_message);
     free(result);
 }
@@ -18,18 +18,50 @@ typedef struct {
     char *error_message;
 } ParseResult;
 
+// Bytes read from the start of a file to tell its format
+#define DETECT_PREFIX_BYTES (64u << 10)
+
 // Main parser functions
 AlignmentFormat detect_format(const char *filename);
+// Detect the format from the first bytes of an input, without reading it again; the file
+// name (NULL if there is none) only decides between formats the content fits equally
+AlignmentFormat detect_format_prefix(const char *data, size_t size, const char *filename);
 ParseResult *parse_alignment(const char *filename);
 ParseResult *parse_alignment_with_format(const char *filename, AlignmentFormat format);
 void free_parse_result(ParseResult *result);
 
+// Parse text already in memory, such as piped input or a whole file read as its prefix;
+// takes over input (name only names it in messages)
+ParseResult *parse_alignment_text(MappedFile *input, const char *name, AlignmentFormat format);
+
+// Parse the prefix of a longer input, cut back to the last whole record, for a quick first look
+// while the full parse runs; takes over prefix. NULL if the format cannot be read from a prefix;
+// a prefix that fails to parse gives a result with its error, as the whole input would fail the same way
+ParseResult *parse_alignment_preview(MappedFile *prefix, const char *name, AlignmentFormat format);
+
 // Format-specific parsers
 SeqList *parse_fasta(const char *path);  // Already exists
 SeqList *parse_phy(const char *path);
 SeqList *parse_maf(const char *path);
 SeqList *parse_aln(const char *path);
 
+// Parse text already in memory; these take over input (path only names it in messages)
+SeqList *parse_maf_mapped(MappedFile *input, const char *path);
+SeqList *parse_phy_mapped(MappedFile *input, const char *path);
+SeqList *parse_aln_mapped(MappedFile *input, const char *path);
+
+// Parsers report how far they got every PARSE_PROGRESS_STEP bytes of input
+#define PARSE_PROGRESS_STEP (4u << 20)
+
+// Record the progress of the parse in flight as work done out of a total
+void parse_progress_report(size_t done, size_t total);
+
+// Percent of the parse in flight that is done, or -1 when nothing was reported
+int parse_progress_percent(void);
+
+// Rebuild a MAF source from the block index its save hook wrote (blob must outlive the source)
+SeqSource *restore_maf_source(const char *path, const void *blob, size_t size);
+
 // Helper functions
 const char *format_to_string(AlignmentFormat format);
 const char *format_to_extension(AlignmentFormat format); 
\ No newline at end of file
@@ -3,258 +3,204 @@
 #include <string.h>
 #include <ctype.h>
 #include <strings.h>
-#include "parser_fasta.h"
+#include "parser.h"
+#include "mapped_file.h"
+#include "name_table.h"
+#include "seqscan.h"
+#include "seqtype.h"
+#include "gapindex.h"
+#include "nucpack.h"
 
-#define MAX_NAME_LENGTH 256
-#define MAX_SEQ_BUFFER 1000000
-
-// Helper function to check if a line is empty or contains only whitespace
-static int is_empty_line(const char *line) {
-    if (!line) return 1;
-    for (size_t i = 0; i < strlen(line); i++) {
-        if (!isspace(line[i])) return 0;
-    }
-    return 1;
-}
+// One sequence being assembled from the interleaved blocks
+typedef struct {
+    const char *name;  // borrowed from the mapping
+    size_t name_len;
+    char  *data;
+    size_t len, cap;
+} AlnRow;
 
 // Helper function to check if a line is a consensus line (contains *, :, ., or spaces)
-static int is_consensus_line(const char *line) {
-    if (!line || strlen(line) == 0) return 0;
-    
+static int is_consensus_line(const char *line, size_t len) {
     // Skip leading whitespace to find the actual content
-    const char *content = line;
-    while (*content && isspace(*content)) content++;
+    size_t i = 0;
+    while (i < len && isspace((unsigned char)line[i])) i++;
     
-    if (!*content) return 0; // Empty line
+    if (i == len) return 0; // Empty line
     
     // Check if line contains only consensus characters
-    for (const char *p = content; *p && *p != '\n' && *p != '\r'; p++) {
-        if (*p != '*' && *p != ':' && *p != '.' && *p != ' ') {
+    for (; i < len; i++) {
+        if (line[i] != '*' && line[i] != ':' && line[i] != '.' && line[i] != ' ') {
             return 0; // Found non-consensus character
         }
     }
     return 1;
 }
 
-// Helper function to detect sequence type (reused from FASTA parser)
-static SequenceType detect_sequence_type(const char *seq, size_t len) {
-    if (len == 0) return SEQ_UNKNOWN;
-    
-    int dna_chars = 0;
-    int rna_chars = 0;
-    int total_chars = 0;
-    
-    for (size_t i = 0; i < len; i++) {
-        char c = toupper(seq[i]);
-        
-        if (c == '-' || c == 'N' || c == 'X' || c == '<' || c == '>' || c == '*' || c == '.' || isspace(c)) {
-            continue;
-        }
-        
-        total_chars++;
-        
-        if (c == 'A' || c == 'T' || c == 'G' || c == 'C') {
-            dna_chars++;
-        }
-        
-        if (c == 'A' || c == 'U' || c == 'G' || c == 'C') {
-            rna_chars++;
-        }
-    }
-    
-    if (total_chars < 4) return SEQ_UNKNOWN;
-    
-    double dna_pct = (double)dna_chars / total_chars;
-    double rna_pct = (double)rna_chars / total_chars;
-    
-    if (dna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
-            }
-        }
-        return SEQ_DNA;
-    }
-    
-    if (rna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
-            }
-        }
-    }
-    
-    return SEQ_PROTEIN;
+// Helper function to slice the next whitespace-delimited token out of [*p, end)
+static size_t next_token(const char **p, const char *end, const char **token) {
+    const char *q = *p;
+    while (q < end && isspace((unsigned char)*q)) q++;
+    *token = q;
+    q += scan_find_space(q, end - q);
+    *p = q;
+    return q - *token;
 }
 
 // Main ALN parser function
 SeqList *parse_aln(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    MappedFile mf;
+    if (mapped_file_open(&mf, path) != 0) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", path);
         return NULL;
     }
+    return parse_aln_mapped(&mf, path);
+}
 
-    SeqList *sl = calloc(1, sizeof(SeqList));
-    sl->capacity = 16;
-    sl->items = calloc(sl->capacity, sizeof(Sequence));
-    
-    char *line = NULL;
-    size_t len = 0;
+SeqList *parse_aln_mapped(MappedFile *input, const char *path) {
+    MappedFile mf = *input;
+    input->data = NULL;
+    input->size = 0;
+
+    const char *p = mf.data;
+    const char *end = mf.data + mf.size;
     
     // Skip header line (should start with CLUSTAL)
-    if (getline(&line, &len, f) == -1) {
+    if (mf.size == 0) {
         fprintf(stderr, "Error: Empty file '%s'\n", path);
-        fclose(f);
-        free(line);
-        free(sl->items);
-        free(sl);
+        mapped_file_close(&mf);
         return NULL;
     }
     
-    if (strncasecmp(line, "CLUSTAL", 7) != 0) {
+    if (mf.size < 7 || strncasecmp(p, "CLUSTAL", 7) != 0) {
         fprintf(stderr, "Error: Not a valid CLUSTAL file - missing CLUSTAL header\n");
-        fclose(f);
-        free(line);
-        free(sl->items);
-        free(sl);
+        mapped_file_close(&mf);
         return NULL;
     }
+    const char *nl = memchr(p, '\n', end - p);
+    p = nl ? nl + 1 : end;
     
     // Storage for sequences - we'll discover sequence names as we go
-    char **sequence_names = NULL;
-    char **sequence_data = NULL;
-    int sequence_count = 0;
-    int sequence_capacity = 0;
+    AlnRow *rows = NULL;
+    int row_count = 0;
+    int row_capacity = 0;
+    NameTable names;  // keys borrow the row names
+    if (name_table_init(&names) != 0) goto out_of_memory;
     
-    // Parse CLUSTAL blocks
+    // Rows repeat in the same order in every block, so the next row is usually last + 1
+    int last = -1;
     
-    while (getline(&line, &len, f) != -1) {
-        
-        // Remove trailing newline
-        size_t line_len = strlen(line);
-        if (line_len > 0 && line[line_len - 1] == '\n') {
-            line[line_len - 1] = '\0';
-        }
-        if (line_len > 1 && line[line_len - 2] == '\r') {
-            line[line_len - 2] = '\0';
-        }
+    // Parse CLUSTAL blocks
+    while (p < end) {
+        const char *line = p;
+        nl = memchr(p, '\n', end - p);
+        size_t line_len = (nl ? nl : end) - line;
+        p = nl ? nl + 1 : end;
+        if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
         
         // Skip empty lines and consensus lines
-        if (is_empty_line(line) || is_consensus_line(line)) {
+        if (scan_is_blank(line, line_len) || is_consensus_line(line, line_len)) {
+            last = -1;
             continue;
         }
         
         // Parse sequence line: name followed by sequence data
-        char *seq_buffer = malloc(MAX_SEQ_BUFFER);
-        if (!seq_buffer) {
-            fprintf(stderr, "Error: Failed to allocate memory for sequence buffer\n");
-            goto cleanup_error;
-        }
-        
-        char name_buffer[MAX_NAME_LENGTH];
-        if (sscanf(line, "%s %s", name_buffer, seq_buffer) != 2) {
-            free(seq_buffer);
+        const char *q = line;
+        const char *name, *residues;
+        size_t name_len = next_token(&q, line + line_len, &name);
+        size_t residues_len = next_token(&q, line + line_len, &residues);
+        if (name_len == 0 || residues_len == 0) {
             continue; // Skip lines that don't match expected format
         }
         
-        // Found sequence line
-        
         // Find or create this sequence
-        int seq_index = -1;
-        for (int i = 0; i < sequence_count; i++) {
-            if (strcmp(sequence_names[i], name_buffer) == 0) {
-                seq_index = i;
-                break;
-            }
+        int idx = last + 1;
+        if (idx >= row_count || rows[idx].name_len != name_len ||
+            memcmp(rows[idx].name, name, name_len) != 0) {
+            idx = name_table_find(&names, name, name_len);
         }
         
-        if (seq_index == -1) {
+        if (idx < 0) {
             // New sequence - add it
-            if (sequence_count >= sequence_capacity) {
-                sequence_capacity = (sequence_capacity == 0) ? 16 : sequence_capacity * 2;
-                sequence_names = realloc(sequence_names, sequence_capacity * sizeof(char*));
-                sequence_data = realloc(sequence_data, sequence_capacity * sizeof(char*));
-                if (!sequence_names || !sequence_data) {
-                    fprintf(stderr, "Error: Failed to allocate memory for sequences\n");
-                    free(seq_buffer);
-                    goto cleanup_error;
-                }
+            if (row_count >= row_capacity) {
+                int capacity = (row_capacity == 0) ? 16 : row_capacity * 2;
+                AlnRow *grown = realloc(rows, capacity * sizeof(AlnRow));
+                if (!grown) goto out_of_memory;
+                rows = grown;
+                row_capacity = capacity;
             }
             
-            seq_index = sequence_count;
-            sequence_names[seq_index] = strdup(name_buffer);
-            sequence_data[seq_index] = calloc(MAX_SEQ_BUFFER, sizeof(char));
-            sequence_count++;
-            
-            // Added new sequence
-        }
+            idx = row_count++;
+            rows[idx].name = name;
+            rows[idx].name_len = name_len;
+            rows[idx].data = NULL;
+            rows[idx].len = 0;
+            rows[idx].cap = 0;
+            if (name_table_insert(&names, rows[idx].name, name_len, idx) != 0) goto out_of_memory;
+        }
+        last = idx;
         
-        // Append sequence data (remove any spaces)
-        char *clean_seq = sequence_data[seq_index] + strlen(sequence_data[seq_index]);
-        for (char *p = seq_buffer; *p; p++) {
-            if (!isspace(*p)) {
-                *clean_seq++ = *p;
-            }
-        }
-        *clean_seq = '\0';
-        
-        free(seq_buffer);
+        // Append sequence data, growing the row geometrically
+        AlnRow *row = &rows[idx];
+        if (row->len + residues_len + 1 > row->cap) {
+            size_t cap = row->cap ? row->cap * 2 : 256;
+            while (cap < row->len + residues_len + 1) cap *= 2;
+            char *grown = realloc(row->data, cap);
+            if (!grown) goto out_of_memory;
+            row->data = grown;
+            row->cap = cap;
+        }
+        memcpy(row->data + row->len, residues, residues_len);
+        row->len += residues_len;
     }
+    name_table_free(&names);
     
     // Finished parsing sequences
     
-    if (sequence_count == 0) {
+    if (row_count == 0) {
         fprintf(stderr, "Error: No sequences found in ALN file '%s'\n", path);
-        goto cleanup_error;
-    }
-    
-    // Create final sequences
-    for (int i = 0; i < sequence_count; i++) {
-        if (sl->count >= sl->capacity) {
-            sl->capacity *= 2;
-            sl->items = realloc(sl->items, sl->capacity * sizeof(Sequence));
-        }
-        
-        Sequence *seq = &sl->items[sl->count];
-        seq->id = sequence_names[i];  // Transfer ownership
-        seq->seq = sequence_data[i];  // Transfer ownership
-        seq->len = strlen(seq->seq);
-        seq->type = detect_sequence_type(seq->seq, seq->len);
-        sl->count++;
-        
-        // Created sequence successfully
+        free(rows);
+        mapped_file_close(&mf);
+        return NULL;
     }
     
-    // Clean up temporary arrays (but not the data inside, which was transferred)
-    free(sequence_names);
-    free(sequence_data);
-    free(line);
-    fclose(f);
-    
-    return sl;
-    
-cleanup_error:
-    // Clean up on error
-    if (sequence_names) {
-        for (int i = 0; i < sequence_count; i++) {
-            free(sequence_names[i]);
-        }
-        free(sequence_names);
-    }
-    if (sequence_data) {
-        for (int i = 0; i < sequence_count; i++) {
-            free(sequence_data[i]);
-        }
-        free(sequence_data);
+    // Create final sequences, packing every row into one residue block
+    size_t total = 0;
+    for (int i = 0; i < row_count; i++) total += rows[i].len + 1;
+
+    SeqList *sl = seqlist_new(row_count);
+    char *block = sl ? arena_alloc(&sl->residues, total) : NULL;
+    for (int i = 0; i < row_count && block; i++) {
+        long idx = seqlist_add(sl, rows[i].name, rows[i].name_len);
+        if (idx < 0) {
+            block = NULL;
+            break;
+        }
+        memcpy(block, rows[i].data, rows[i].len);
+        block[rows[i].len] = '\0';
+        sl->seqs[idx] = block;
+        sl->lens[idx] = rows[i].len;
+        block += rows[i].len + 1;
     }
-    free(line);
-    fclose(f);
     
-    if (sl) {
-        free(sl->items);
-        free(sl);
+    for (int i = 0; i < row_count; i++) free(rows[i].data);
+    free(rows);
+    mapped_file_close(&mf);
+    if (!block) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        seqlist_free(sl);
+        return NULL;
     }
     
+    seqtype_classify_list(sl, SEQTYPE_SAMPLE_BYTES);
+    gapindex_list(sl);
+    nucpack_list(sl);
+    return sl;
+
+out_of_memory:
+    fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+    name_table_free(&names);
+    for (int i = 0; i < row_count; i++) free(rows[i].data);
+    free(rows);
+    mapped_file_close(&mf);
     return NULL;
-} 
\ No newline at end of file
+}
@@ -1,211 +1,683 @@
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include "parser_fasta.h"
+#include <unistd.h>
+#include <sys/mman.h>
+#include "parser.h"
+#include "mapped_file.h"
+#include "bgzf.h"
+#include "faidx.h"
+#include "workpool.h"
+#include "seqscan.h"
+#include "seqtype.h"
+#include "gapindex.h"
+#include "nucpack.h"
 
-// simple growable arrays
-#define MAX_SEQ 1000000
+// One record located in the mapped file during the indexing pass
+typedef struct {
+    const char *id;      // header text after '>'
+    size_t      id_len;
+    const char *body;    // first byte after the header line
+    const char *end;     // first byte of the next header (or end of file)
+    size_t      len;     // number of residues in the record
+} FastaRecord;
+
+// Files bigger than this share of physical memory are read through a record index
+#define FASTA_OUT_OF_CORE_SHARE 4
+#define FASTA_CLASSIFY_ROWS_PER_TASK 16
+
+// Resident files are indexed and copied in chunks of about this size, one worker per chunk
+#define FASTA_CHUNK_BYTES (8u << 20)
+
+// Files that look like they hold more records than this open lazily
+#define FASTA_LAZY_ROWS         100000
+#define FASTA_LAZY_PROBE_BYTES  (1u << 20)
+#define FASTA_LAZY_TYPE_SAMPLES 1024
+// Upper bound for residues kept in joined lazy rows
+#define FASTA_ROW_CACHE_BYTES   (64u << 20)
+
+// Lazy FASTA backend: rows are copied out of the file by offset arithmetic on demand
+typedef struct {
+    SeqSource  base;
+    MappedFile file;        // the file as stored
+    BgzfIndex  index;       // block layout when the file is BGZF compressed
+    BgzfReader reader;
+    bool       compressed;
+    FaiText    text;
+    FaiRecord *recs;
+} FastaSource;
+
+static size_t fasta_fetch(SeqSource *src, size_t row, size_t start, size_t n, char *out) {
+    FastaSource *fs = (FastaSource *)src;
+    faidx_copy(&fs->recs[row], &fs->text, start, n, out);
+    return n;
+}
+
+static void fasta_destroy(SeqSource *src) {
+    FastaSource *fs = (FastaSource *)src;
+    free(fs->recs);
+    if (fs->compressed) {
+        bgzf_reader_free(&fs->reader);
+        bgzf_index_free(&fs->index);
+    }
+    mapped_file_close(&fs->file);
+    free(fs);
+}
+
+typedef struct {
+    SeqList *sl;
+    FastaSource *fs;
+    ResidueCounts *counts;
+} FastaClassifyJob;
+
+// Helper function to classify rows straight from the file. Line breaks count as whitespace,
+// so the raw bytes of mapped records give the same tallies as the residues alone; compressed
+// records are classified from their first residues rather than inflated whole
+static void classify_mapped_rows(size_t begin, size_t end, void *arg) {
+    FastaClassifyJob *job = arg;
+    char *head = job->fs->compressed ? malloc(SEQTYPE_SAMPLE_BYTES) : NULL;
+    for (size_t i = begin; i < end; i++) {
+        const FaiRecord *rec = &job->fs->recs[i];
+        size_t len = job->sl->lens[i];
+        if (!job->fs->compressed) {
+            const char *body = job->fs->text.data + rec->offset;
+            seqtype_count(body, faidx_record_bytes(rec, len), SEQTYPE_SAMPLE_BYTES, &job->counts[i]);
+        } else if (head) {
+            size_t n = len < SEQTYPE_SAMPLE_BYTES ? len : SEQTYPE_SAMPLE_BYTES;
+            faidx_copy(rec, &job->fs->text, 0, n, head);
+            seqtype_count(head, n, 0, &job->counts[i]);
+        }
+        job->sl->types[i] = seqtype_from_counts(&job->counts[i]);
+    }
+    free(head);
+}
+
+// Helper function to get the file size above which records stay in the file
+static size_t out_of_core_bytes(void) {
+    long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) return SIZE_MAX;
+    return (size_t)pages * (size_t)page_size / FASTA_OUT_OF_CORE_SHARE;
+}
+
+// Helper function to open a FASTA file through its .fai index, building and saving the
+// index when there is no usable one. idx is the block layout of a BGZF file (NULL if the
+// file is not compressed). Takes over the mapping and idx on success, NULL otherwise
+static SeqList *parse_fasta_indexed(const char *path, MappedFile *mf, const BgzfIndex *idx) {
+    SeqList *sl = seqlist_new(16);
+    FastaSource *fs = sl ? calloc(1, sizeof(FastaSource)) : NULL;
+    if (!fs) {
+        seqlist_free(sl);
+        return NULL;
+    }
+
+    fs->text.data = mf->data;
+    fs->text.size = mf->size;
+    if (idx) {
+        fs->index = *idx;
+        fs->compressed = true;
+        if (bgzf_reader_init(&fs->reader, mf->data, &fs->index) != 0) {
+            seqlist_free(sl);
+            free(fs);
+            return NULL;
+        }
+        fs->text.data = NULL;
+        fs->text.size = bgzf_size(idx);
+        fs->text.bgzf = &fs->reader;
+    }
+
+    fs->recs = faidx_read(path, &fs->text, sl);
+    if (!fs->recs) {
+        // Drop whatever a stale index added and scan the file instead
+        seqlist_free(sl);
+        sl = seqlist_new(16);
+        fs->recs = sl ? faidx_scan(&fs->text, sl) : NULL;
+        if (!fs->recs) {
+            seqlist_free(sl);
+            if (idx) bgzf_reader_free(&fs->reader);
+            free(fs);
+            return NULL;
+        }
+        // Without a writable directory the index is simply rebuilt next time
+        faidx_write(path, sl, fs->recs);
+    }
+
+    fs->file = *mf;
+    fs->base.fetch = fasta_fetch;
+    fs->base.destroy = fasta_destroy;
+    sl->source = &fs->base;
+    mf->data = NULL;
+    mf->size = 0;
+
+    FastaClassifyJob job = { sl, fs, calloc(sl->count, sizeof(ResidueCounts)) };
+    if (job.counts) {
+        workpool_run(sl->count, FASTA_CLASSIFY_ROWS_PER_TASK, classify_mapped_rows, &job);
+        ResidueCounts all = {0};
+        for (size_t i = 0; i < sl->count; i++) scan_add_counts(&all, &job.counts[i]);
+        sl->type = seqtype_from_counts(&all);
+        free(job.counts);
+    }
+
+    // Viewing jumps between rows, so drop the sequential read-ahead set for parsing
+    madvise((void *)fs->file.data, fs->file.size, MADV_NORMAL);
+    return sl;
+}
+
+// Helper function to cut the next line out of [*p, end); returns its length up to the first CR or LF
+static size_t next_line(const char **p, const char *end, const char **line, size_t *raw_len) {
+    const char *start = *p;
+    size_t len = scan_find_eol(start, end - start);
+    const char *nl = start + len;
+    if (nl < end && *nl != '\n') nl = memchr(nl, '\n', end - nl);
+    *p = (nl && nl < end) ? nl + 1 : end;
+    *line = start;
+    *raw_len = *p - start;  // including the line terminator, if any
+    return len;
+}
 
 // Helper function to check if a line looks like a FASTA header
-static int is_fasta_header(const char *line) {
-    return line && line[0] == '>' && strlen(line) > 1;
+static int is_fasta_header(const char *line, size_t raw_len) {
+    return line[0] == '>' && raw_len > 1;
 }
 
-// Helper function to check if a line looks like a sequence
-static int is_sequence_line(const char *line) {
-    if (!line || strlen(line) == 0) return 0;
-    
-    // Check if line contains only valid nucleotide/protein characters
-    for (size_t i = 0; i < strlen(line); i++) {
-        char c = toupper(line[i]);
-        if (c == '\n' || c == '\r') continue;  // Skip newlines
-        if (c == '-' || c == 'N' || c == 'X') continue;  // Allow gaps and unknown bases
-        if (c >= 'A' && c <= 'Z') continue;  // Allow amino acids/nucleotides
-        if (isspace(c)) continue;  // Allow whitespace
-        if (c == '<' || c == '>' || c == '*' || c == '.') continue;  // Allow special characters
-        return 0;  // Invalid character found
-    }
-    return 1;
-}
-
-// Helper function to detect sequence type
-static SequenceType detect_sequence_type(const char *seq, size_t len) {
-    if (len == 0) return SEQ_UNKNOWN;
-    
-    int dna_chars = 0;
-    int rna_chars = 0;
-    int total_chars = 0;
-    
-    // Count characters to determine sequence type
-    for (size_t i = 0; i < len; i++) {
-        char c = toupper(seq[i]);
-        
-        // Skip gaps, unknowns, and special characters
-        if (c == '-' || c == 'N' || c == 'X' || c == '<' || c == '>' || c == '*' || c == '.' || isspace(c)) {
+// Helper function to join the non-blank lines of a record body into out; returns the residue count
+static size_t copy_residues(const char *body, const char *end, char *out) {
+    size_t len = 0;
+    const char *q = body;
+    while (q < end) {
+        const char *line;
+        size_t raw_len;
+        size_t line_len = next_line(&q, end, &line, &raw_len);
+        if (scan_is_blank(line, line_len)) continue;
+        memcpy(out + len, line, line_len);
+        len += line_len;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// Lazy row of a file with very many records: where it lives and, once touched, its residues
+typedef struct {
+    size_t body, end;          // byte range of the record's sequence lines
+    size_t len;                // residue count
+    bool   contiguous;         // a single line right after the header, readable in place
+    char  *decoded;            // joined residues of a multi-line record (NULL until used)
+    long   lru_prev, lru_next;
+} LazyRow;
+
+// Lazy FASTA backend: only record boundaries are indexed up front, multi-line rows are
+// joined on first access and the coldest ones dropped to stay within a memory budget
+typedef struct {
+    SeqSource  base;
+    MappedFile file;
+    LazyRow   *rows;
+    size_t     row_count;
+    long       lru_head, lru_tail;  // most / least recently used decoded row
+    size_t     cached_bytes;
+} LazyFastaSource;
+
+static void lazy_lru_unlink(LazyFastaSource *ls, long r) {
+    LazyRow *lr = &ls->rows[r];
+    if (lr->lru_prev >= 0) ls->rows[lr->lru_prev].lru_next = lr->lru_next;
+    else ls->lru_head = lr->lru_next;
+    if (lr->lru_next >= 0) ls->rows[lr->lru_next].lru_prev = lr->lru_prev;
+    else ls->lru_tail = lr->lru_prev;
+    lr->lru_prev = lr->lru_next = -1;
+}
+
+static void lazy_lru_push_front(LazyFastaSource *ls, long r) {
+    LazyRow *lr = &ls->rows[r];
+    lr->lru_prev = -1;
+    lr->lru_next = ls->lru_head;
+    if (ls->lru_head >= 0) ls->rows[ls->lru_head].lru_prev = r;
+    ls->lru_head = r;
+    if (ls->lru_tail < 0) ls->lru_tail = r;
+}
+
+// Get the residues of a row, joining its lines if they are not cached
+static const char *lazy_get_row(LazyFastaSource *ls, long r) {
+    LazyRow *lr = &ls->rows[r];
+    if (lr->contiguous) return ls->file.data + lr->body;
+    if (lr->decoded) {
+        lazy_lru_unlink(ls, r);
+        lazy_lru_push_front(ls, r);
+        return lr->decoded;
+    }
+
+    // Evict least recently used rows to stay within the budget
+    while (ls->lru_tail >= 0 && ls->cached_bytes + lr->len > FASTA_ROW_CACHE_BYTES) {
+        long victim = ls->lru_tail;
+        lazy_lru_unlink(ls, victim);
+        free(ls->rows[victim].decoded);
+        ls->rows[victim].decoded = NULL;
+        ls->cached_bytes -= ls->rows[victim].len;
+    }
+
+    lr->decoded = malloc(lr->len + 1);
+    if (!lr->decoded) return NULL;
+    copy_residues(ls->file.data + lr->body, ls->file.data + lr->end, lr->decoded);
+    ls->cached_bytes += lr->len;
+    lazy_lru_push_front(ls, r);
+    return lr->decoded;
+}
+
+static size_t lazy_fetch(SeqSource *src, size_t row, size_t start, size_t n, char *out) {
+    LazyFastaSource *ls = (LazyFastaSource *)src;
+    const char *text = lazy_get_row(ls, (long)row);
+    if (!text) return 0;
+    memcpy(out, text + start, n);
+    return n;
+}
+
+static void lazy_destroy(SeqSource *src) {
+    LazyFastaSource *ls = (LazyFastaSource *)src;
+    for (size_t i = 0; i < ls->row_count; i++) free(ls->rows[i].decoded);
+    free(ls->rows);
+    mapped_file_close(&ls->file);
+    free(ls);
+}
+
+// Helper function to extrapolate the record count of a file from the headers in its first bytes
+static size_t estimate_records(const MappedFile *mf) {
+    size_t probe = mf->size < FASTA_LAZY_PROBE_BYTES ? mf->size : FASTA_LAZY_PROBE_BYTES;
+    if (probe == 0) return 0;
+    size_t headers = mf->data[0] == '>';
+    const char *p = mf->data, *end = mf->data + probe;
+    while ((p = memmem(p, end - p, "\n>", 2)) != NULL) {
+        headers++;
+        p += 2;
+    }
+    return headers * (mf->size / probe);
+}
+
+// Helper function to index only the record boundaries and ids of a file with very many records.
+// Anything unusual, bad residue lines included, is left to the full parser (NULL)
+static SeqList *parse_fasta_lazy(MappedFile *mf) {
+    SeqList *sl = seqlist_new(estimate_records(mf));
+    LazyFastaSource *ls = sl ? calloc(1, sizeof(LazyFastaSource)) : NULL;
+    size_t capacity = sl ? sl->capacity : 0;
+    LazyRow *rows = ls ? malloc(capacity * sizeof(LazyRow)) : NULL;
+    if (!rows) goto fail;
+
+    LazyRow *cur = NULL;
+    const char *p = mf->data, *end = mf->data + mf->size;
+    while (p < end) {
+        const char *line;
+        size_t raw_len;
+        size_t line_len = next_line(&p, end, &line, &raw_len);
+        if (scan_is_blank(line, line_len)) continue;
+
+        if (line[0] != '>') {
+            if (!cur || !scan_is_residue_text(line, line_len)) goto fail;
+            // Only a record that is one line right after its header can be read in place
+            cur->contiguous = cur->len == 0 && line == mf->data + cur->body;
+            cur->len += line_len;
             continue;
         }
-        
-        total_chars++;
-        
-        // Check for DNA characters
-        if (c == 'A' || c == 'T' || c == 'G' || c == 'C') {
-            dna_chars++;
-        }
-        
-        // Check for RNA characters (U instead of T)
-        if (c == 'A' || c == 'U' || c == 'G' || c == 'C') {
-            rna_chars++;
+
+        if (!is_fasta_header(line, raw_len) || (cur && cur->len == 0)) goto fail;
+        if (cur) cur->end = line - mf->data;
+        long row = seqlist_add(sl, line + 1, line_len - 1);
+        if (row < 0) goto fail;
+        if (sl->count > capacity) {
+            capacity = sl->capacity;
+            LazyRow *grown = realloc(rows, capacity * sizeof(LazyRow));
+            if (!grown) goto fail;
+            rows = grown;
         }
+        cur = &rows[row];
+        *cur = (LazyRow){ .body = p - mf->data, .end = mf->size, .lru_prev = -1, .lru_next = -1 };
     }
-    
-    // Need at least 4 characters to make a reliable determination
-    if (total_chars < 4) return SEQ_UNKNOWN;
-    
-    // Calculate percentages
-    double dna_pct = (double)dna_chars / total_chars;
-    double rna_pct = (double)rna_chars / total_chars;
-    
-    // If 95% or more of characters are DNA bases, it's DNA
-    if (dna_pct >= 0.95) {
-        // Check if it contains U (would make it RNA)
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
+    if (!cur || cur->len == 0) goto fail;
+
+    ls->file = *mf;
+    ls->rows = rows;
+    ls->row_count = sl->count;
+    ls->lru_head = ls->lru_tail = -1;
+    ls->base.fetch = lazy_fetch;
+    ls->base.destroy = lazy_destroy;
+    sl->source = &ls->base;
+    mf->data = NULL;
+    mf->size = 0;
+
+    // Rows stay unclassified; the alignment type comes from an even sample of the records,
+    // counted on the raw bytes where line breaks are just whitespace
+    ResidueCounts all = {0};
+    size_t step = sl->count > FASTA_LAZY_TYPE_SAMPLES ? sl->count / FASTA_LAZY_TYPE_SAMPLES : 1;
+    for (size_t i = 0; i < sl->count; i += step) {
+        seqtype_count(ls->file.data + rows[i].body, rows[i].end - rows[i].body, SEQTYPE_SAMPLE_BYTES, &all);
+    }
+    for (size_t i = 0; i < sl->count; i++) sl->lens[i] = rows[i].len;
+    sl->type = seqtype_from_counts(&all);
+
+    madvise((void *)ls->file.data, ls->file.size, MADV_NORMAL);
+    return sl;
+
+fail:
+    free(rows);
+    free(ls);
+    seqlist_free(sl);
+    return NULL;
+}
+
+// Ways pass 1 can reject a chunk; the first failing chunk in file order is the one reported
+typedef enum {
+    FASTA_CHUNK_OK,
+    FASTA_CHUNK_BAD_HEADER,
+    FASTA_CHUNK_BAD_SEQUENCE,
+    FASTA_CHUNK_NO_HEADER,
+    FASTA_CHUNK_NO_MEMORY
+} FastaChunkError;
+
+// One slice of the input, indexed on its own during pass 1
+typedef struct {
+    const char     *start;       // the start of the file or of a header line
+    const char     *end;
+    FastaRecord    *recs;
+    size_t          rec_count;
+    size_t          first_row;   // row of recs[0] in the merged list
+    int             lines;       // lines read, up to and including a failing one
+    int             found_header;
+    int             found_sequence;
+    FastaChunkError error;
+} FastaChunk;
+
+typedef struct {
+    FastaChunk   *chunks;
+    SeqList      *sl;
+    const char   *data;
+    size_t        size;
+    atomic_size_t done;  // bytes through both passes, for progress
+} FastaChunkJob;
+
+// Helper function to count bytes a worker got through towards the progress of both passes
+static void chunk_progress(FastaChunkJob *job, size_t bytes) {
+    size_t done = atomic_fetch_add(&job->done, bytes) + bytes;
+    parse_progress_report(done, 2 * job->size);
+}
+
+// Helper function to cut the input into chunks of about FASTA_CHUNK_BYTES that each start a line
+// with '>'. Each cut resumes where the previous one was found, so the scan stays linear even
+// when one record spans most of the file. Returns the chunk count, 0 when out of memory
+static size_t split_chunks(const char *data, size_t size, FastaChunk **out) {
+    size_t wanted = size / FASTA_CHUNK_BYTES + 1;
+    FastaChunk *chunks = calloc(wanted, sizeof(FastaChunk));
+    if (!chunks) return 0;
+
+    const char *end = data + size;
+    const char *from = data;
+    size_t count = 1;
+    chunks[0].start = data;
+    for (size_t i = 1; i < wanted; i++) {
+        const char *target = data + size / wanted * i;
+        if (target > from) from = target;
+        const char *cut = NULL;
+        while (from < end) {
+            const char *nl = memchr(from, '\n', end - from);
+            if (!nl || nl + 1 >= end) break;
+            from = nl + 1;
+            if (*from == '>') {
+                cut = from;
+                break;
             }
         }
-        return SEQ_DNA;
+        if (!cut) break;
+        chunks[count - 1].end = cut;
+        chunks[count++].start = cut;
     }
-    
-    // If 95% or more of characters are RNA bases and contains U, it's RNA
-    if (rna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
+    chunks[count - 1].end = end;
+    *out = chunks;
+    return count;
+}
+
+// Helper function for pass 1: index the records of each chunk, validating as we go
+static void index_chunks(size_t begin, size_t end, void *arg) {
+    FastaChunkJob *job = arg;
+    for (size_t c = begin; c < end; c++) {
+        FastaChunk *ch = &job->chunks[c];
+        size_t rec_capacity = 0;
+        FastaRecord *cur = NULL;
+        const char *p = ch->start;
+        const char *reported = p;
+        while (p < ch->end) {
+            if ((size_t)(p - reported) >= PARSE_PROGRESS_STEP) {
+                chunk_progress(job, p - reported);
+                reported = p;
+            }
+            const char *line;
+            size_t raw_len;
+            size_t line_len = next_line(&p, ch->end, &line, &raw_len);
+            ch->lines++;
+
+            // Skip empty lines and whitespace-only lines
+            if (scan_is_blank(line, line_len)) {
+                continue;
+            }
+
+            if (line[0] == '>') {
+                // Found a header
+                ch->found_header = 1;
+                if (!is_fasta_header(line, raw_len)) {
+                    ch->error = FASTA_CHUNK_BAD_HEADER;
+                    break;
+                }
+
+                if (cur) cur->end = line;
+                if (ch->rec_count == rec_capacity) {
+                    size_t grown = rec_capacity ? rec_capacity * 2 : 16;
+                    FastaRecord *bigger = realloc(ch->recs, grown * sizeof(FastaRecord));
+                    if (!bigger) {
+                        ch->error = FASTA_CHUNK_NO_MEMORY;
+                        break;
+                    }
+                    ch->recs = bigger;
+                    rec_capacity = grown;
+                }
+                cur = &ch->recs[ch->rec_count++];
+                cur->id = line + 1;
+                cur->id_len = line_len - 1;
+                cur->body = p;
+                cur->end = ch->end;
+                cur->len = 0;
+            } else if (cur) {
+                // We have a current sequence, so this should be sequence data
+                if (!scan_is_residue_text(line, line_len)) {
+                    ch->error = FASTA_CHUNK_BAD_SEQUENCE;
+                    break;
+                }
+
+                ch->found_sequence = 1;
+                cur->len += line_len;
+            } else {
+                // Sequence data before any header; only the first chunk can start without one
+                ch->error = FASTA_CHUNK_NO_HEADER;
+                break;
             }
         }
+        chunk_progress(job, p - reported);
     }
-    
-    // Otherwise, assume it's protein
-    return SEQ_PROTEIN;
+}
+
+// Helper function for pass 2: copy the records of each chunk into the rows laid out for them
+static void copy_chunks(size_t begin, size_t end, void *arg) {
+    FastaChunkJob *job = arg;
+    for (size_t c = begin; c < end; c++) {
+        FastaChunk *ch = &job->chunks[c];
+        for (size_t i = 0; i < ch->rec_count; i++) {
+            FastaRecord *r = &ch->recs[i];
+            copy_residues(r->body, r->end, job->sl->seqs[ch->first_row + i]);
+        }
+        chunk_progress(job, ch->end - ch->start);
+    }
+}
+
+// Release the chunk index and the mapping, once the rows were copied or parsing failed
+static void fasta_release(MappedFile *mf, FastaChunk *chunks, size_t chunk_count) {
+    for (size_t c = 0; c < chunk_count; c++) free(chunks[c].recs);
+    free(chunks);
+    mapped_file_close(mf);
 }
 
 SeqList *parse_fasta(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) { 
+    MappedFile mf;
+    if (mapped_file_map(&mf, path) != 0) { 
         fprintf(stderr, "Error: Cannot open file '%s'\n", path);
         return NULL;
     }
 
-    SeqList *sl = calloc(1, sizeof(*sl));
-    sl->capacity = 16;
-    sl->items    = calloc(sl->capacity, sizeof(Sequence));
+    if (gzip_detect(mf.data, mf.size)) {
+        // BGZF text too big to hold in memory is read block by block, through a record index
+        BgzfIndex idx;
+        if (bgzf_index_build(mf.data, mf.size, &idx) == 0) {
+            if (bgzf_size(&idx) >= out_of_core_bytes()) {
+                SeqList *sl = parse_fasta_indexed(path, &mf, &idx);
+                if (sl) return sl;
+            }
+            bgzf_index_free(&idx);
+        }
+        if (gzip_inflate_file(&mf, SIZE_MAX) != 0) {
+            fprintf(stderr, "Error: Cannot decompress file '%s'\n", path);
+            mapped_file_close(&mf);
+            return NULL;
+        }
+    } else if (mf.size >= out_of_core_bytes()) {
+        // Files too big to hold in memory are viewed in place, through a record index
+        SeqList *sl = parse_fasta_indexed(path, &mf, NULL);
+        if (sl) return sl;
+    }
+
+    return parse_fasta_loaded(&mf, path);
+}
+
+SeqList *parse_fasta_loaded(MappedFile *input, const char *path) {
+    // With very many records, index only where they are and decode rows as they are viewed
+    if (estimate_records(input) >= FASTA_LAZY_ROWS) {
+        SeqList *sl = parse_fasta_lazy(input);
+        if (sl) return sl;
+    }
+
+    return parse_fasta_mapped(input, path);
+}
+
+SeqList *parse_fasta_mapped(MappedFile *input, const char *path) {
+    MappedFile mf = *input;
+    input->data = NULL;
+    input->size = 0;
+
+    // Cut the input at record starts so the chunks can be indexed and copied in parallel
+    FastaChunk *chunks = NULL;
+    size_t chunk_count = split_chunks(mf.data, mf.size, &chunks);
+    if (chunk_count == 0) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        mapped_file_close(&mf);
+        return NULL;
+    }
+
+    // Pass 1: index record boundaries and residue counts, validating as we go.
+    // Both passes walk the whole input, so each counts for half of the progress
+    FastaChunkJob job = { chunks, NULL, mf.data, mf.size, 0 };
+    workpool_run(chunk_count, 1, index_chunks, &job);
 
-    char *line = NULL;
-    size_t  len = 0;
-    Sequence *cur = NULL;
+    // Merge in file order: the first failing chunk holds the first bad line
     int line_num = 0;
     int found_header = 0;
     int found_sequence = 0;
-
-    while (getline(&line, &len, f) != -1) {
-        line_num++;
-        
-        // Skip empty lines and whitespace-only lines
-        if (strlen(line) == 0 || strspn(line, " \t\n\r") == strlen(line)) {
-            continue;
-        }
-        
-        if (line[0] == '>') {
-            // Found a header
-            found_header = 1;
-            if (!is_fasta_header(line)) {
-                fprintf(stderr, "Error: Invalid FASTA header at line %d\n", line_num);
-                free(line);
-                fclose(f);
-                free(sl->items);
-                free(sl);
-                return NULL;
-            }
-            
-            if (sl->count == sl->capacity) {
-                sl->capacity *= 2;
-                sl->items = realloc(sl->items, sl->capacity * sizeof(Sequence));
-            }
-            cur = &sl->items[sl->count++];
-            cur->id = strdup(line + 1);
-            cur->seq = calloc(1, MAX_SEQ);
-            cur->len = 0;
-            cur->type = SEQ_UNKNOWN;  // Will be determined after sequence is complete
-        } else if (cur) {
-            // We have a current sequence, so this should be sequence data
-            if (!is_sequence_line(line)) {
-                fprintf(stderr, "Error: Invalid sequence data at line %d\n", line_num);
-                free(line);
-                fclose(f);
-                free(sl->items);
-                free(sl);
-                return NULL;
-            }
-            
-            found_sequence = 1;
-            // strip newline & append
-            char *p = strchr(line, '\n');
-            if (p) *p = 0;
-            p = strchr(line, '\r');
-            if (p) *p = 0;
-            
-            size_t l = strlen(line);
-            if (l > 0 && cur->len + l < MAX_SEQ) {
-                memcpy(cur->seq + cur->len, line, l);
-                cur->len += l;
-            }
-        } else {
-            // We found sequence data before any header - not a valid FASTA file
+    size_t rec_count = 0;
+    for (size_t c = 0; c < chunk_count; c++) {
+        FastaChunk *ch = &chunks[c];
+        line_num += ch->lines;
+        switch (ch->error) {
+        case FASTA_CHUNK_OK:
+            break;
+        case FASTA_CHUNK_BAD_HEADER:
+            fprintf(stderr, "Error: Invalid FASTA header at line %d\n", line_num);
+            fasta_release(&mf, chunks, chunk_count);
+            return NULL;
+        case FASTA_CHUNK_BAD_SEQUENCE:
+            fprintf(stderr, "Error: Invalid sequence data at line %d\n", line_num);
+            fasta_release(&mf, chunks, chunk_count);
+            return NULL;
+        case FASTA_CHUNK_NO_HEADER:
             fprintf(stderr, "Error: Found sequence data before FASTA header at line %d\n", line_num);
             fprintf(stderr, "This doesn't appear to be a valid FASTA file\n");
-            free(line);
-            fclose(f);
-            free(sl->items);
-            free(sl);
+            fasta_release(&mf, chunks, chunk_count);
+            return NULL;
+        case FASTA_CHUNK_NO_MEMORY:
+            fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+            fasta_release(&mf, chunks, chunk_count);
             return NULL;
         }
+        found_header |= ch->found_header;
+        found_sequence |= ch->found_sequence;
+        ch->first_row = rec_count;
+        rec_count += ch->rec_count;
     }
     
-    free(line);
-    fclose(f);
-    
     // Validate that we found at least one header
     if (!found_header) {
         fprintf(stderr, "Error: No FASTA headers found in file '%s'\n", path);
         fprintf(stderr, "This doesn't appear to be a valid FASTA file\n");
-        free(sl->items);
-        free(sl);
+        fasta_release(&mf, chunks, chunk_count);
         return NULL;
     }
     
     // Validate that we found at least one sequence
-    if (!found_sequence || sl->count == 0) {
+    if (!found_sequence || rec_count == 0) {
         fprintf(stderr, "Error: No sequences found in file '%s'\n", path);
         fprintf(stderr, "The FASTA file appears to be empty or corrupted\n");
-        free(sl->items);
-        free(sl);
+        fasta_release(&mf, chunks, chunk_count);
         return NULL;
     }
     
-    // Check for sequences without data and detect sequence types
-    for (size_t i = 0; i < sl->count; i++) {
-        if (sl->items[i].len == 0) {
-            fprintf(stderr, "Error: Found sequence header without sequence data\n");
-            fprintf(stderr, "The FASTA file appears to be corrupted\n");
-            free(sl->items);
-            free(sl);
-            return NULL;
+    // Check for sequences without data
+    size_t total = 0;
+    for (size_t c = 0; c < chunk_count; c++) {
+        for (size_t i = 0; i < chunks[c].rec_count; i++) {
+            if (chunks[c].recs[i].len == 0) {
+                fprintf(stderr, "Error: Found sequence header without sequence data\n");
+                fprintf(stderr, "The FASTA file appears to be corrupted\n");
+                fasta_release(&mf, chunks, chunk_count);
+                return NULL;
+            }
+            total += chunks[c].recs[i].len + 1;
         }
-        
-        // Detect sequence type for each sequence
-        sl->items[i].type = detect_sequence_type(sl->items[i].seq, sl->items[i].len);
     }
-    
+
+    // Pass 2: lay out every row in one residue block, then copy the chunks into it in parallel
+    SeqList *sl = seqlist_new(rec_count);
+    char *block = sl ? arena_alloc(&sl->residues, total) : NULL;
+    if (!block) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        seqlist_free(sl);
+        fasta_release(&mf, chunks, chunk_count);
+        return NULL;
+    }
+
+    for (size_t c = 0; c < chunk_count; c++) {
+        for (size_t i = 0; i < chunks[c].rec_count; i++) {
+            FastaRecord *r = &chunks[c].recs[i];
+            long row = seqlist_add(sl, r->id, r->id_len);
+            if (row < 0) {
+                fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+                seqlist_free(sl);
+                fasta_release(&mf, chunks, chunk_count);
+                return NULL;
+            }
+            sl->seqs[row] = block;
+            sl->lens[row] = r->len;
+            block += r->len + 1;
+        }
+    }
+
+    job.sl = sl;
+    workpool_run(chunk_count, 1, copy_chunks, &job);
+
+    fasta_release(&mf, chunks, chunk_count);
+
+    // Detect sequence type for each sequence
+    seqtype_classify_list(sl, SEQTYPE_SAMPLE_BYTES);
+    gapindex_list(sl);
+    nucpack_list(sl);
     return sl;
 }
@@ -1,23 +1,14 @@
 #pragma once
 #include <stddef.h>
+#include "seqlist.h"
+#include "mapped_file.h"
 
-typedef enum {
-    SEQ_DNA,
-    SEQ_RNA,
-    SEQ_PROTEIN,
-    SEQ_UNKNOWN
-} SequenceType;
-
-typedef struct {
-    char *id;
-    char *seq;
-    size_t len;
-    SequenceType type;
-} Sequence;
+SeqList *parse_fasta(const char *path);
 
-typedef struct {
-    Sequence *items;
-    size_t count, capacity;
-} SeqList;
+// Parse FASTA text already in memory, keeping every row resident; takes over input
+// (path only names the input in messages)
+SeqList *parse_fasta_mapped(MappedFile *input, const char *path);
 
-SeqList *parse_fasta(const char *path);
+// Parse FASTA text already in memory as parse_fasta would once the file is read: lazily when it
+// holds very many records, resident otherwise; takes over input
+SeqList *parse_fasta_loaded(MappedFile *input, const char *path);
@@ -1,346 +1,599 @@
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include "parser_fasta.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "parser.h"
+#include "name_table.h"
+#include "mapped_file.h"
+#include "maf_tokenizer.h"
+#include "seqtype.h"
+#include "gapindex.h"
+#include "workpool.h"
 
-#define MAX_LINE_LENGTH 100000
-#define MAX_SPECIES_NAME 256
-#define MAX_ALIGNMENT_LENGTH 10000000
+// Where one alignment block lives in the file and which rows it covers
+typedef struct {
+    size_t  offset;     // byte offset of the block's 'a' line
+    size_t  col_start;  // first alignment column of the block
+    size_t  length;     // block width in columns
+    int    *rows;       // species row of each sequence line, in file order
+    int     row_count;
+
+    // decoded block cache, linked in least-recently-used order
+    MAFBlock *decoded;
+    long      lru_prev, lru_next;
+} MAFBlockIndex;
 
-// Structure to hold a single MAF alignment block
+// Lazy MAF backend: only the block index stays in memory, blocks are decoded on demand
 typedef struct {
-    char *species;
-    int start;
-    int size;
-    char strand;
-    int src_size;
-    char *sequence;
-} MAFSequence;
+    SeqSource      base;
+    MappedFile     file;
+    MAFBlockIndex *blocks;
+    size_t         block_count;
+    long           lru_head, lru_tail;  // most / least recently used decoded block
+    size_t         cached_bytes;
+    bool           rows_borrowed;       // block rows point into a cache file, not the heap
+} MAFSource;
 
+// What the indexing pass gathers for one species row
 typedef struct {
-    MAFSequence *sequences;
-    int sequence_count;
-    int alignment_length;
-} MAFBlock;
-
-// Helper function to check if a line is empty or contains only whitespace
-static int is_empty_line(const char *line) {
-    if (!line) return 1;
-    for (size_t i = 0; i < strlen(line); i++) {
-        if (!isspace(line[i])) return 0;
+    ResidueCounts counts;
+    size_t covered;                // end column of the last block holding the species
+    size_t *gap_start, *gap_len;   // column ranges with no block for the species
+    size_t gap_count, gap_cap;
+} SpeciesScan;
+
+// Helper function to record that a species has no block over [from, to); returns 0 on success,
+// -1 when out of memory
+static int add_absent_run(SpeciesScan *sp, size_t from, size_t to) {
+    if (sp->gap_count >= sp->gap_cap) {
+        size_t cap = sp->gap_cap ? sp->gap_cap * 2 : 8;
+        size_t *start = realloc(sp->gap_start, cap * sizeof(size_t));
+        if (start) sp->gap_start = start;
+        size_t *len = realloc(sp->gap_len, cap * sizeof(size_t));
+        if (len) sp->gap_len = len;
+        if (!start || !len) return -1;
+        sp->gap_cap = cap;
     }
-    return 1;
+    sp->gap_start[sp->gap_count] = from;
+    sp->gap_len[sp->gap_count] = to - from;
+    sp->gap_count++;
+    return 0;
 }
 
-// Helper function to detect sequence type (reused from FASTA parser)
-static SequenceType detect_sequence_type(const char *seq, size_t len) {
-    if (len == 0) return SEQ_UNKNOWN;
-    
-    int dna_chars = 0;
-    int rna_chars = 0;
-    int total_chars = 0;
+// Upper bound for residues kept in decoded blocks
+#define MAF_CACHE_BYTES (64u << 20)
+
+// Helper function to get the decoded size of a block for cache accounting
+static size_t maf_block_bytes(const MAFBlockIndex *bi) {
+    return bi->length * (size_t)bi->row_count;
+}
+
+static void maf_lru_unlink(MAFSource *ms, long b) {
+    MAFBlockIndex *bi = &ms->blocks[b];
+    if (bi->lru_prev >= 0) ms->blocks[bi->lru_prev].lru_next = bi->lru_next;
+    else ms->lru_head = bi->lru_next;
+    if (bi->lru_next >= 0) ms->blocks[bi->lru_next].lru_prev = bi->lru_prev;
+    else ms->lru_tail = bi->lru_prev;
+    bi->lru_prev = bi->lru_next = -1;
+}
+
+static void maf_lru_push_front(MAFSource *ms, long b) {
+    MAFBlockIndex *bi = &ms->blocks[b];
+    bi->lru_prev = -1;
+    bi->lru_next = ms->lru_head;
+    if (ms->lru_head >= 0) ms->blocks[ms->lru_head].lru_prev = b;
+    ms->lru_head = b;
+    if (ms->lru_tail < 0) ms->lru_tail = b;
+}
+
+// Get a decoded block, reading it from the file if it is not cached
+static MAFBlock *maf_get_block(MAFSource *ms, long b) {
+    MAFBlockIndex *bi = &ms->blocks[b];
+    if (bi->decoded) {
+        maf_lru_unlink(ms, b);
+        maf_lru_push_front(ms, b);
+        return bi->decoded;
+    }
     
-    for (size_t i = 0; i < len; i++) {
-        char c = toupper(seq[i]);
-        
-        if (c == '-' || c == 'N' || c == 'X' || c == '<' || c == '>' || c == '*' || c == '.' || isspace(c)) {
-            continue;
-        }
-        
-        total_chars++;
-        
-        if (c == 'A' || c == 'T' || c == 'G' || c == 'C') {
-            dna_chars++;
-        }
-        
-        if (c == 'A' || c == 'U' || c == 'G' || c == 'C') {
-            rna_chars++;
-        }
+    // Evict least recently used blocks to stay within the budget
+    size_t need = maf_block_bytes(bi);
+    while (ms->lru_tail >= 0 && ms->cached_bytes + need > MAF_CACHE_BYTES) {
+        long victim = ms->lru_tail;
+        maf_lru_unlink(ms, victim);
+        free_maf_block(ms->blocks[victim].decoded);
+        ms->blocks[victim].decoded = NULL;
+        ms->cached_bytes -= maf_block_bytes(&ms->blocks[victim]);
     }
     
-    if (total_chars < 4) return SEQ_UNKNOWN;
+    MAFTokenizer tk;
+    maf_tokenizer_init(&tk, ms->file.data, ms->file.size, bi->offset);
+    bi->decoded = maf_read_block(&tk);
+    if (!bi->decoded) return NULL;
     
-    double dna_pct = (double)dna_chars / total_chars;
-    double rna_pct = (double)rna_chars / total_chars;
+    ms->cached_bytes += need;
+    maf_lru_push_front(ms, b);
+    return bi->decoded;
+}
+
+static size_t maf_fetch(SeqSource *src, size_t row, size_t start, size_t n, char *out) {
+    MAFSource *ms = (MAFSource *)src;
     
-    if (dna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
-            }
-        }
-        return SEQ_DNA;
+    // Binary search for the block containing the first requested column
+    size_t lo = 0, hi = ms->block_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ms->blocks[mid].col_start <= start) lo = mid;
+        else hi = mid;
     }
     
-    if (rna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
+    size_t done = 0;
+    for (size_t b = lo; b < ms->block_count && done < n; b++) {
+        MAFBlockIndex *bi = &ms->blocks[b];
+        size_t within = start + done - bi->col_start;
+        size_t take = bi->length - within;
+        if (take > n - done) take = n - done;
+        
+        // Species absent from the block (or an unreadable block) shows as gaps
+        const char *text = NULL;
+        size_t text_len = 0;
+        for (int k = 0; k < bi->row_count; k++) {
+            if (bi->rows[k] == (int)row) {
+                MAFBlock *block = maf_get_block(ms, b);
+                if (block) {
+                    text = block->sequences[k].sequence;
+                    text_len = block->sequences[k].length;
+                }
+                break;
             }
         }
+        
+        size_t copied = 0;
+        if (text && within < text_len) {
+            copied = text_len - within;
+            if (copied > take) copied = take;
+            memcpy(out + done, text + within, copied);
+        }
+        memset(out + done + copied, '-', take - copied);
+        done += take;
     }
-    
-    return SEQ_PROTEIN;
+    return done;
 }
 
-// Free a MAF block
-static void free_maf_block(MAFBlock *block) {
-    if (!block) return;
+static void maf_destroy(SeqSource *src) {
+    MAFSource *ms = (MAFSource *)src;
+    for (size_t b = 0; b < ms->block_count; b++) {
+        free_maf_block(ms->blocks[b].decoded);
+        if (!ms->rows_borrowed) free(ms->blocks[b].rows);
+    }
+    free(ms->blocks);
+    mapped_file_close(&ms->file);
+    free(ms);
+}
+
+// Block index as stored in the sidecar cache
+typedef struct {
+    uint64_t offset, col_start, length, row_count;
+} MAFSavedBlock;
+
+// Helper function to write the block index: counts, one MAFSavedBlock per block, then every block's rows
+static int maf_save(SeqSource *src, FILE *out) {
+    MAFSource *ms = (MAFSource *)src;
+    uint64_t counts[2] = { ms->block_count, 0 };
+    for (size_t b = 0; b < ms->block_count; b++) counts[1] += ms->blocks[b].row_count;
+    if (fwrite(counts, sizeof(counts), 1, out) != 1) return -1;
     
-    if (block->sequences) {
-        for (int i = 0; i < block->sequence_count; i++) {
-            free(block->sequences[i].species);
-            free(block->sequences[i].sequence);
-        }
-        free(block->sequences);
+    for (size_t b = 0; b < ms->block_count; b++) {
+        MAFBlockIndex *bi = &ms->blocks[b];
+        MAFSavedBlock saved = { bi->offset, bi->col_start, bi->length, (uint64_t)bi->row_count };
+        if (fwrite(&saved, sizeof(saved), 1, out) != 1) return -1;
+    }
+    for (size_t b = 0; b < ms->block_count; b++) {
+        MAFBlockIndex *bi = &ms->blocks[b];
+        if (fwrite(bi->rows, sizeof(int), bi->row_count, out) != (size_t)bi->row_count) return -1;
     }
-    free(block);
+    return 0;
 }
 
-// Parse a single MAF alignment block
-static MAFBlock *parse_maf_block(FILE *f, char **current_line, size_t *len, int *line_num) {
-    MAFBlock *block = calloc(1, sizeof(MAFBlock));
-    int sequences_capacity = 16;
-    block->sequences = calloc(sequences_capacity, sizeof(MAFSequence));
+SeqSource *restore_maf_source(const char *path, const void *blob, size_t size) {
+    uint64_t counts[2];
+    if (sizeof(int) != sizeof(int32_t) || size < sizeof(counts)) return NULL;
+    memcpy(counts, blob, sizeof(counts));
+    if (counts[0] > (size - sizeof(counts)) / sizeof(MAFSavedBlock) ||
+        counts[1] > (size - sizeof(counts) - counts[0] * sizeof(MAFSavedBlock)) / sizeof(int)) {
+        return NULL;
+    }
     
-    // Skip to alignment header (line starting with 'a')
-    while (getline(current_line, len, f) != -1) {
-        (*line_num)++;
-        
-        // Remove trailing newline
-        size_t line_len = strlen(*current_line);
-        if (line_len > 0 && (*current_line)[line_len - 1] == '\n') {
-            (*current_line)[line_len - 1] = '\0';
-        }
-        if (line_len > 1 && (*current_line)[line_len - 2] == '\r') {
-            (*current_line)[line_len - 2] = '\0';
-        }
-        
-        // Skip empty lines and comments
-        if (is_empty_line(*current_line) || (*current_line)[0] == '#') {
-            continue;
-        }
-        
-        // Found alignment header
-        if ((*current_line)[0] == 'a') {
-            break;
-        }
-        
-        // If we hit a line that doesn't start with 'a', this might not be MAF format
-        free_maf_block(block);
+    MAFSource *ms = calloc(1, sizeof(MAFSource));
+    if (!ms) return NULL;
+    ms->blocks = malloc((counts[0] ? counts[0] : 1) * sizeof(MAFBlockIndex));
+    if (!ms->blocks || mapped_file_open(&ms->file, path) != 0) {
+        free(ms->blocks);
+        free(ms);
         return NULL;
     }
+    ms->base.fetch = maf_fetch;
+    ms->base.destroy = maf_destroy;
+    ms->base.save = maf_save;
+    ms->lru_head = ms->lru_tail = -1;
+    ms->rows_borrowed = true;
     
-    // Parse sequence lines (lines starting with 's')
-    while (getline(current_line, len, f) != -1) {
-        (*line_num)++;
-        
-        // Remove trailing newline
-        size_t line_len = strlen(*current_line);
-        if (line_len > 0 && (*current_line)[line_len - 1] == '\n') {
-            (*current_line)[line_len - 1] = '\0';
-        }
-        if (line_len > 1 && (*current_line)[line_len - 2] == '\r') {
-            (*current_line)[line_len - 2] = '\0';
-        }
-        
-        // End of block if we hit an empty line or another block
-        if (is_empty_line(*current_line) || (*current_line)[0] == 'a') {
-            // Put the line back for the next block
-            fseek(f, -((long)strlen(*current_line) + 1), SEEK_CUR);
-            (*line_num)--;
-            break;
-        }
-        
-        // Skip non-sequence lines
-        if ((*current_line)[0] != 's') {
-            continue;
-        }
-        
-        // Parse sequence line: s species start size strand src_size sequence
-        char species_name[MAX_SPECIES_NAME];
-        int start, size, src_size;
-        char strand;
-        char *sequence = malloc(MAX_ALIGNMENT_LENGTH);
-        if (!sequence) {
-            fprintf(stderr, "Error: Failed to allocate memory for sequence buffer\n");
-            free_maf_block(block);
+    const MAFSavedBlock *saved = (const MAFSavedBlock *)((const char *)blob + sizeof(counts));
+    int *rows = (int *)(saved + counts[0]);
+    uint64_t used = 0;
+    for (size_t b = 0; b < counts[0]; b++) {
+        if (saved[b].row_count > counts[1] - used) {
+            ms->block_count = b;
+            maf_destroy(&ms->base);
             return NULL;
         }
-        
-        if (sscanf(*current_line, "s %s %d %d %c %d %s", 
-                  species_name, &start, &size, &strand, &src_size, sequence) != 6) {
-            fprintf(stderr, "Error: Invalid MAF sequence line at line %d\n", *line_num);
-            free(sequence);
-            free_maf_block(block);
-            return NULL;
-        }
-        
-        // Expand sequences array if needed
-        if (block->sequence_count >= sequences_capacity) {
-            sequences_capacity *= 2;
-            block->sequences = realloc(block->sequences, sequences_capacity * sizeof(MAFSequence));
-        }
-        
-        // Store sequence information
-        MAFSequence *seq = &block->sequences[block->sequence_count];
-        seq->species = strdup(species_name);
-        seq->start = start;
-        seq->size = size;
-        seq->strand = strand;
-        seq->src_size = src_size;
-        seq->sequence = strdup(sequence);
-        
-        // Update alignment length
-        int seq_len = strlen(sequence);
-        if (seq_len > block->alignment_length) {
-            block->alignment_length = seq_len;
+        MAFBlockIndex *bi = &ms->blocks[b];
+        bi->offset = saved[b].offset;
+        bi->col_start = saved[b].col_start;
+        bi->length = saved[b].length;
+        bi->row_count = (int)saved[b].row_count;
+        bi->rows = rows + used;
+        bi->decoded = NULL;
+        bi->lru_prev = bi->lru_next = -1;
+        used += saved[b].row_count;
+    }
+    ms->block_count = counts[0];
+    return &ms->base;
+}
+
+// Files are indexed in chunks of about this size, cut at 'a' lines, one worker per chunk
+#define MAF_CHUNK_BYTES (8u << 20)
+
+// A species as first seen in one chunk
+typedef struct {
+    const char   *name;   // slice of the input
+    size_t        name_len;
+    ResidueCounts counts;
+} ChunkSpecies;
+
+// One slice of the input, indexed on its own. Block rows hold chunk species numbers
+// (in order of first sight) until the merge maps them to list rows
+typedef struct {
+    size_t         start, end;   // byte range; start is 0 or the offset of an 'a' line
+    MAFBlockIndex *blocks;
+    size_t         block_count;
+    ChunkSpecies  *species;
+    size_t         species_count;
+    int            lines;        // lines read, up to and including a malformed one
+    MAFStop        stop;
+} MAFChunk;
+
+typedef struct {
+    MAFChunk     *chunks;
+    const char   *data;
+    size_t        size;
+    atomic_size_t done;  // bytes indexed, for progress
+} MAFChunkJob;
+
+// Helper function to tell whether the line at p is a block's 'a' line
+static bool is_align_line(const char *p, const char *end) {
+    return p < end && *p == 'a' && (p + 1 == end || p[1] == ' ' || p[1] == '\t' || p[1] == '\n');
+}
+
+// Helper function to cut the input into chunks of about MAF_CHUNK_BYTES that each start at an
+// 'a' line. Each cut resumes where the previous one was found, so the scan stays linear.
+// Returns the chunk count, 0 when out of memory
+static size_t split_chunks(const char *data, size_t size, MAFChunk **out) {
+    size_t wanted = size / MAF_CHUNK_BYTES + 1;
+    MAFChunk *chunks = calloc(wanted, sizeof(MAFChunk));
+    if (!chunks) return 0;
+
+    const char *end = data + size;
+    const char *from = data;
+    size_t count = 1;
+    for (size_t i = 1; i < wanted; i++) {
+        const char *target = data + size / wanted * i;
+        if (target > from) from = target;
+        const char *cut = NULL;
+        while (from < end) {
+            const char *nl = memchr(from, '\n', end - from);
+            if (!nl) break;
+            from = nl + 1;
+            if (is_align_line(from, end)) {
+                cut = from;
+                break;
+            }
         }
-        
-        block->sequence_count++;
-        
-        free(sequence);
+        if (!cut) break;
+        chunks[count - 1].end = cut - data;
+        chunks[count++].start = cut - data;
     }
-    
-    if (block->sequence_count == 0) {
-        free_maf_block(block);
-        return NULL;
+    chunks[count - 1].end = size;
+    *out = chunks;
+    return count;
+}
+
+// Helper function to index the blocks of each chunk and tally residues per chunk species
+static void index_chunks(size_t begin, size_t end, void *arg) {
+    MAFChunkJob *job = arg;
+    for (size_t c = begin; c < end; c++) {
+        MAFChunk *ch = &job->chunks[c];
+        NameTable species;  // keys borrow the input
+        bool out_of_memory = name_table_init(&species) != 0;
+        size_t block_capacity = 0, species_capacity = 0;
+        MAFTokenizer tk;
+        maf_tokenizer_init(&tk, job->data, ch->end, ch->start);
+        size_t reported = ch->start;
+
+        while (!out_of_memory) {
+            MAFBlock *block = maf_read_block(&tk);
+            if (!block) break;
+            if (block->offset - reported >= PARSE_PROGRESS_STEP) {
+                size_t done = atomic_fetch_add(&job->done, block->offset - reported) + block->offset - reported;
+                parse_progress_report(done, job->size);
+                reported = block->offset;
+            }
+
+            // Expand blocks array if needed
+            if (ch->block_count >= block_capacity) {
+                size_t capacity = block_capacity ? block_capacity * 2 : 16;
+                MAFBlockIndex *grown = realloc(ch->blocks, capacity * sizeof(MAFBlockIndex));
+                if (grown) {
+                    ch->blocks = grown;
+                    block_capacity = capacity;
+                }
+            }
+            int *rows = ch->block_count < block_capacity ? malloc(block->sequence_count * sizeof(int)) : NULL;
+            if (!rows) {
+                free_maf_block(block);
+                out_of_memory = true;
+                break;
+            }
+
+            MAFBlockIndex *bi = &ch->blocks[ch->block_count++];
+            bi->offset = block->offset;
+            bi->col_start = 0;
+            bi->length = block->alignment_length;
+            bi->row_count = block->sequence_count;
+            bi->rows = rows;
+            bi->decoded = NULL;
+            bi->lru_prev = bi->lru_next = -1;
+
+            for (int s = 0; s < block->sequence_count; s++) {
+                MAFSequence *ms_seq = &block->sequences[s];
+
+                // Number the species on first sight
+                size_t name_len = ms_seq->species_len;
+                int local = name_table_find(&species, ms_seq->species, name_len);
+                if (local < 0) {
+                    if (ch->species_count >= species_capacity) {
+                        size_t capacity = species_capacity ? species_capacity * 2 : 16;
+                        ChunkSpecies *grown = realloc(ch->species, capacity * sizeof(ChunkSpecies));
+                        if (!grown) {
+                            out_of_memory = true;
+                            break;
+                        }
+                        ch->species = grown;
+                        species_capacity = capacity;
+                    }
+                    local = (int)ch->species_count++;
+                    ChunkSpecies *sp = &ch->species[local];
+                    memset(sp, 0, sizeof(ChunkSpecies));
+                    sp->name = ms_seq->species;
+                    sp->name_len = name_len;
+                    if (name_table_insert(&species, sp->name, name_len, local) != 0) {
+                        out_of_memory = true;
+                        break;
+                    }
+                }
+                bi->rows[s] = local;
+                scan_count_residues(ms_seq->sequence, ms_seq->length, &ch->species[local].counts);
+            }
+
+            free_maf_block(block);
+        }
+        name_table_free(&species);
+        ch->lines = tk.line_num;
+        ch->stop = out_of_memory ? MAF_STOP_NO_MEMORY : tk.stop;
+
+        size_t done = atomic_fetch_add(&job->done, ch->end - reported) + ch->end - reported;
+        parse_progress_report(done, job->size);
     }
-    
-    return block;
 }
 
 // Main MAF parser function
 SeqList *parse_maf(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    MappedFile mf;
+    if (mapped_file_open(&mf, path) != 0) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", path);
         return NULL;
     }
-    
-    SeqList *sl = calloc(1, sizeof(SeqList));
-    sl->capacity = 16;
-    sl->items = calloc(sl->capacity, sizeof(Sequence));
-    
-    char *line = NULL;
-    size_t len = 0;
-    int line_num = 0;
-    
-    // Parse MAF blocks and collect all unique species
-    MAFBlock **blocks = NULL;
-    int block_count = 0;
-    int block_capacity = 16;
-    blocks = calloc(block_capacity, sizeof(MAFBlock*));
-    
-    // Read all blocks
-    while (!feof(f)) {
-        MAFBlock *block = parse_maf_block(f, &line, &len, &line_num);
-        if (!block) break;
-        
-        // Expand blocks array if needed
-        if (block_count >= block_capacity) {
-            block_capacity *= 2;
-            blocks = realloc(blocks, block_capacity * sizeof(MAFBlock*));
-        }
-        
-        blocks[block_count++] = block;
+    return parse_maf_mapped(&mf, path);
+}
+
+SeqList *parse_maf_mapped(MappedFile *input, const char *path) {
+    MAFSource *ms = calloc(1, sizeof(MAFSource));
+    if (!ms) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        mapped_file_close(input);
+        return NULL;
     }
+    ms->file = *input;
+    input->data = NULL;
+    input->size = 0;
+    ms->base.fetch = maf_fetch;
+    ms->base.destroy = maf_destroy;
+    ms->base.save = maf_save;
+    ms->lru_head = ms->lru_tail = -1;
     
-    if (block_count == 0) {
-        fprintf(stderr, "Error: No valid MAF blocks found in file '%s'\n", path);
-        free(blocks);
-        free(line);
-        fclose(f);
-        free(sl->items);
-        free(sl);
+    SeqList *sl = seqlist_new(16);
+    if (!sl) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        maf_destroy(&ms->base);
         return NULL;
     }
+    sl->source = &ms->base;
     
-    // Collect all unique species names
-    char **species_names = calloc(256, sizeof(char*));
-    int species_count = 0;
+    // Index the chunks in parallel: tokenizing and residue counting are most of the work
+    MAFChunk *chunks = NULL;
+    size_t chunk_count = split_chunks(ms->file.data, ms->file.size, &chunks);
+    if (chunk_count == 0) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        seqlist_free(sl);
+        return NULL;
+    }
+    MAFChunkJob job = { chunks, ms->file.data, ms->file.size, 0 };
+    workpool_run(chunk_count, 1, index_chunks, &job);
     
-    for (int b = 0; b < block_count; b++) {
-        MAFBlock *block = blocks[b];
-        for (int s = 0; s < block->sequence_count; s++) {
-            char *species = block->sequences[s].species;
-            
-            // Check if this species is already in our list
-            int found = 0;
-            for (int i = 0; i < species_count; i++) {
-                if (strcmp(species_names[i], species) == 0) {
-                    found = 1;
+    // Merge in file order, so rows come in order of first sight as in one serial pass
+    SpeciesScan *scan = NULL;
+    size_t scan_capacity = 0;
+    NameTable species;  // keys borrow the row ids
+    bool out_of_memory = name_table_init(&species) != 0;
+    size_t block_capacity = 0;
+    size_t total_length = 0;
+    int line_num = 0;
+    size_t c = 0;
+    for (; c < chunk_count && !out_of_memory; c++) {
+        MAFChunk *ch = &chunks[c];
+        if (ch->stop == MAF_STOP_NO_MEMORY) {
+            // Its last block may be only partly indexed
+            out_of_memory = true;
+            break;
+        }
+        
+        // Map the chunk's species to rows, registering new ones
+        int *rows = malloc((ch->species_count ? ch->species_count : 1) * sizeof(int));
+        if (!rows) {
+            out_of_memory = true;
+            break;
+        }
+        for (size_t k = 0; k < ch->species_count && !out_of_memory; k++) {
+            ChunkSpecies *cs = &ch->species[k];
+            int row = name_table_find(&species, cs->name, cs->name_len);
+            if (row < 0) {
+                if (sl->count >= scan_capacity) {
+                    size_t capacity = scan_capacity ? scan_capacity * 2 : 16;
+                    SpeciesScan *grown = realloc(scan, capacity * sizeof(SpeciesScan));
+                    if (!grown) {
+                        out_of_memory = true;
+                        break;
+                    }
+                    scan = grown;
+                    scan_capacity = capacity;
+                }
+                // Rows are served by the block index, so only the id is stored
+                long idx = seqlist_add(sl, cs->name, cs->name_len);
+                if (idx < 0) {
+                    out_of_memory = true;
+                    break;
+                }
+                row = (int)idx;
+                memset(&scan[row], 0, sizeof(SpeciesScan));
+                if (name_table_insert(&species, sl->ids[row], cs->name_len, row) != 0) {
+                    out_of_memory = true;
                     break;
                 }
             }
-            
-            if (!found) {
-                species_names[species_count++] = strdup(species);
+            scan_add_counts(&scan[row].counts, &cs->counts);
+            rows[k] = row;
+        }
+        
+        // Place the chunk's blocks after the ones before them
+        size_t needed = ms->block_count + ch->block_count;
+        if (!out_of_memory && needed > block_capacity) {
+            size_t capacity = block_capacity;
+            while (needed > capacity) capacity = capacity ? capacity * 2 : 16;
+            MAFBlockIndex *grown = realloc(ms->blocks, capacity * sizeof(MAFBlockIndex));
+            if (grown) {
+                ms->blocks = grown;
+                block_capacity = capacity;
+            } else {
+                out_of_memory = true;
             }
         }
-    }
-    
-    // Calculate total alignment length
-    int total_length = 0;
-    for (int b = 0; b < block_count; b++) {
-        total_length += blocks[b]->alignment_length;
-    }
-    
-    // Create sequences for each species
-    for (int i = 0; i < species_count; i++) {
-        if (sl->count >= sl->capacity) {
-            sl->capacity *= 2;
-            sl->items = realloc(sl->items, sl->capacity * sizeof(Sequence));
+        if (out_of_memory) {
+            // The chunk's blocks are still its own, and are freed with the rest below
+            free(rows);
+            break;
         }
-        
-        Sequence *seq = &sl->items[sl->count];
-        seq->id = strdup(species_names[i]);
-        seq->seq = calloc(total_length + 1, sizeof(char));
-        seq->len = 0;
-        seq->type = SEQ_UNKNOWN;
-        
-        // Concatenate sequences from all blocks
-        for (int b = 0; b < block_count; b++) {
-            MAFBlock *block = blocks[b];
-            int found_in_block = 0;
-            
-            // Find this species in the current block
-            for (int s = 0; s < block->sequence_count; s++) {
-                if (strcmp(block->sequences[s].species, species_names[i]) == 0) {
-                    strcpy(seq->seq + seq->len, block->sequences[s].sequence);
-                    seq->len += strlen(block->sequences[s].sequence);
-                    found_in_block = 1;
-                    break;
+        for (size_t b = 0; b < ch->block_count; b++) {
+            MAFBlockIndex *bi = &ms->blocks[ms->block_count++];
+            *bi = ch->blocks[b];
+            bi->col_start = total_length;
+            total_length += bi->length;
+            for (int s = 0; s < bi->row_count; s++) {
+                bi->rows[s] = rows[bi->rows[s]];
+                SpeciesScan *sp = &scan[bi->rows[s]];
+                if (bi->col_start > sp->covered && add_absent_run(sp, sp->covered, bi->col_start) != 0) {
+                    out_of_memory = true;  // the chunk's blocks are all handed over before giving up
                 }
-            }
-            
-            // If species not found in this block, add gaps
-            if (!found_in_block) {
-                memset(seq->seq + seq->len, '-', block->alignment_length);
-                seq->len += block->alignment_length;
-                seq->seq[seq->len] = '\0';  // Ensure null termination
+                if (bi->col_start + bi->length > sp->covered) sp->covered = bi->col_start + bi->length;
             }
         }
+        free(rows);
+        free(ch->blocks);
+        free(ch->species);
+        if (out_of_memory) {
+            c++;
+            break;
+        }
         
-        // Detect sequence type
-        seq->type = detect_sequence_type(seq->seq, seq->len);
-        sl->count++;
+        // Parsing ends where a serial pass would have stopped
+        line_num += ch->lines;
+        if (ch->stop != MAF_STOP_EOF) {
+            if (ch->stop == MAF_STOP_MALFORMED) {
+                fprintf(stderr, "Error: Invalid MAF sequence line at line %d\n", line_num);
+            }
+            c++;
+            break;
+        }
     }
-    
-    // Clean up
-    for (int i = 0; i < species_count; i++) {
-        free(species_names[i]);
+    for (; c < chunk_count; c++) {
+        for (size_t b = 0; b < chunks[c].block_count; b++) free(chunks[c].blocks[b].rows);
+        free(chunks[c].blocks);
+        free(chunks[c].species);
     }
-    free(species_names);
-    
-    for (int b = 0; b < block_count; b++) {
-        free_maf_block(blocks[b]);
+    free(chunks);
+    name_table_free(&species);
+
+    // Every species row spans the whole alignment; blocks without it read as gaps
+    for (size_t i = 0; i < sl->count && !out_of_memory; i++) {
+        SpeciesScan *sp = &scan[i];
+        if (total_length > sp->covered && add_absent_run(sp, sp->covered, total_length) != 0) {
+            out_of_memory = true;
+        }
+    }
+    if (out_of_memory) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        for (size_t i = 0; i < sl->count; i++) {
+            free(scan[i].gap_start);
+            free(scan[i].gap_len);
+        }
+        free(scan);
+        seqlist_free(sl);
+        return NULL;
+    }
+    if (ms->block_count == 0) {
+        fprintf(stderr, "Error: No valid MAF blocks found in file '%s'\n", path);
+        free(scan);
+        seqlist_free(sl);
+        return NULL;
     }
-    free(blocks);
     
-    free(line);
-    fclose(f);
+    // The stretches without a block are indexed so scans can jump over them
+    sl->gaps = calloc(sl->capacity, sizeof(GapIndex *));
+    ResidueCounts all = {0};
+    for (size_t i = 0; i < sl->count; i++) {
+        SpeciesScan *sp = &scan[i];
+        if (sl->gaps && sp->gap_count > 0) {
+            sl->gaps[i] = gapindex_build(&sl->meta, sp->gap_start, sp->gap_len, sp->gap_count);
+        }
+        free(sp->gap_start);
+        free(sp->gap_len);
+
+        sl->lens[i] = total_length;
+        sl->types[i] = seqtype_from_counts(&sp->counts);
+        scan_add_counts(&all, &sp->counts);
+    }
+    sl->type = seqtype_from_counts(&all);
+    free(scan);
     
     return sl;
-} 
\ No newline at end of file
+}
@@ -2,154 +2,115 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include "parser_fasta.h"
+#include "parser.h"
+#include "mapped_file.h"
+#include "seqscan.h"
+#include "seqtype.h"
+#include "gapindex.h"
+#include "nucpack.h"
 
-#define MAX_NAME_LENGTH 256
-#define MAX_SEQ_LENGTH 10000000
+// Width of the name field in strict PHYLIP
+#define STRICT_NAME_WIDTH 10
 
-// Helper function to trim whitespace from both ends of a string
-static char *trim_whitespace(char *str) {
-    if (!str) return str;
-    
+// Helper function to trim whitespace from both ends of a slice
+static const char *trim_whitespace(const char *str, size_t *len) {
     // Trim leading whitespace
-    while (isspace(*str)) str++;
+    while (*len > 0 && isspace((unsigned char)*str)) { str++; (*len)--; }
     
     // Trim trailing whitespace
-    char *end = str + strlen(str) - 1;
-    while (end > str && isspace(*end)) end--;
-    *(end + 1) = '\0';
+    while (*len > 0 && isspace((unsigned char)str[*len - 1])) (*len)--;
     
     return str;
 }
 
-// Helper function to check if a line is empty or contains only whitespace
-static int is_empty_line(const char *line) {
-    if (!line) return 1;
-    for (size_t i = 0; i < strlen(line); i++) {
-        if (!isspace(line[i])) return 0;
-    }
-    return 1;
-}
-
-// Helper function to detect sequence type (reused from FASTA parser)
-static SequenceType detect_sequence_type(const char *seq, size_t len) {
-    if (len == 0) return SEQ_UNKNOWN;
-    
-    int dna_chars = 0;
-    int rna_chars = 0;
-    int total_chars = 0;
-    
-    for (size_t i = 0; i < len; i++) {
-        char c = toupper(seq[i]);
-        
-        if (c == '-' || c == 'N' || c == 'X' || c == '<' || c == '>' || c == '*' || c == '.' || isspace(c)) {
-            continue;
-        }
-        
-        total_chars++;
-        
-        if (c == 'A' || c == 'T' || c == 'G' || c == 'C') {
-            dna_chars++;
-        }
-        
-        if (c == 'A' || c == 'U' || c == 'G' || c == 'C') {
-            rna_chars++;
-        }
-    }
-    
-    if (total_chars < 4) return SEQ_UNKNOWN;
-    
-    double dna_pct = (double)dna_chars / total_chars;
-    double rna_pct = (double)rna_chars / total_chars;
-    
-    if (dna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
-            }
-        }
-        return SEQ_DNA;
-    }
-    
-    if (rna_pct >= 0.95) {
-        for (size_t i = 0; i < len; i++) {
-            if (toupper(seq[i]) == 'U') {
-                return SEQ_RNA;
-            }
+// Helper function to append residues (skipping whitespace) to a row of the matrix.
+// Residues past num_sites are counted but not stored so the length check can report them.
+static void append_residues(char *row, size_t *row_len, size_t num_sites, const char *p, const char *end) {
+    size_t len = *row_len;
+    while (p < end) {
+        // copy each run of residues between whitespace in one go
+        size_t run = scan_find_space(p, end - p);
+        if (len < num_sites) {
+            size_t room = num_sites - len;
+            memcpy(row + len, p, run < room ? run : room);
         }
+        len += run;
+        p += run;
+        while (p < end && isspace((unsigned char)*p)) p++;
     }
-    
-    return SEQ_PROTEIN;
+    *row_len = len;
 }
 
 // Main PHY parser function
 SeqList *parse_phy(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    MappedFile mf;
+    if (mapped_file_open(&mf, path) != 0) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", path);
         return NULL;
     }
+    return parse_phy_mapped(&mf, path);
+}
+
+SeqList *parse_phy_mapped(MappedFile *input, const char *path) {
+    MappedFile mf = *input;
+    input->data = NULL;
+    input->size = 0;
 
-    SeqList *sl = calloc(1, sizeof(SeqList));
-    char *line = NULL;
-    size_t len = 0;
+    const char *p = mf.data;
+    const char *end = mf.data + mf.size;
     int line_num = 0;
     int num_sequences = 0;
     int num_sites = 0;
     
     // Read header line
-    if (getline(&line, &len, f) == -1) {
+    if (mf.size == 0) {
         fprintf(stderr, "Error: Empty file '%s'\n", path);
-        fclose(f);
-        free(line);
-        free(sl);
+        mapped_file_close(&mf);
         return NULL;
     }
     
+    const char *nl = memchr(p, '\n', end - p);
+    char header[64];
+    size_t header_len = (nl ? nl : end) - p;
+    if (header_len >= sizeof(header)) header_len = sizeof(header) - 1;
+    memcpy(header, p, header_len);
+    header[header_len] = '\0';
+    p = nl ? nl + 1 : end;
     line_num++;
     
     // Parse header: number of sequences and number of sites
-    if (sscanf(line, "%d %d", &num_sequences, &num_sites) != 2 || num_sequences <= 0 || num_sites <= 0) {
+    if (sscanf(header, "%d %d", &num_sequences, &num_sites) != 2 || num_sequences <= 0 || num_sites <= 0) {
         fprintf(stderr, "Error: Invalid PHY header at line %d. Expected: <num_sequences> <num_sites>\n", line_num);
-        fclose(f);
-        free(line);
-        free(sl);
+        mapped_file_close(&mf);
         return NULL;
     }
     
-    // Initialize sequence list
-    sl->capacity = num_sequences;
-    sl->count = 0;
-    sl->items = calloc(num_sequences, sizeof(Sequence));
-    
-    // Try to detect if this is interleaved format by checking if we have enough sequences
-    // in the first block or if sequences are incomplete
+    // The header sizes everything: one contiguous residue matrix, one NUL-terminated row per sequence
+    size_t stride = (size_t)num_sites + 1;
+    char *matrix = malloc((size_t)num_sequences * stride);
     char **sequence_names = calloc(num_sequences, sizeof(char*));
-    char **sequence_data = calloc(num_sequences, sizeof(char*));
-    int *sequence_lengths = calloc(num_sequences, sizeof(int));
-    
-    for (int i = 0; i < num_sequences; i++) {
-        sequence_data[i] = calloc(num_sites + 1, sizeof(char));
-        sequence_lengths[i] = 0;
+    size_t *sequence_lengths = calloc(num_sequences, sizeof(size_t));
+    if (!matrix || !sequence_names || !sequence_lengths) {
+        fprintf(stderr, "Error: Failed to allocate memory for %d x %d sites\n", num_sequences, num_sites);
+        goto cleanup_error;
     }
     
     int current_seq = 0;
     int in_first_block = 1;
     
-    while (getline(&line, &len, f) != -1) {
+    while (p < end) {
+        const char *line = p;
+        nl = memchr(p, '\n', end - p);
+        size_t line_len = (nl ? nl : end) - line;
+        p = nl ? nl + 1 : end;
         line_num++;
         
-        // Remove trailing newline
-        size_t line_len = strlen(line);
-        if (line_len > 0 && line[line_len - 1] == '\n') {
-            line[line_len - 1] = '\0';
-        }
-        if (line_len > 1 && line[line_len - 2] == '\r') {
-            line[line_len - 2] = '\0';
-        }
+        // Remove trailing CR
+        if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
+        const char *line_end = line + line_len;
         
         // Skip empty lines (they may separate interleaved blocks)
-        if (is_empty_line(line)) {
+        if (scan_is_blank(line, line_len)) {
             if (in_first_block && current_seq == num_sequences) {
                 in_first_block = 0;
                 current_seq = 0;
@@ -157,111 +118,58 @@ SeqList *parse_phy(const char *path) {
             continue;
         }
         
-        // Parse sequence line
-        char name_buffer[MAX_NAME_LENGTH];
-        char *seq_buffer = malloc(MAX_SEQ_LENGTH);
-        if (!seq_buffer) {
-            fprintf(stderr, "Error: Failed to allocate memory for sequence buffer\n");
-            goto cleanup_error;
-        }
+        char *row = matrix + (size_t)current_seq * stride;
         
         if (in_first_block) {
             // First block - extract name and sequence
+            if (current_seq >= num_sequences) {
+                fprintf(stderr, "Error: Too many sequences at line %d\n", line_num);
+                goto cleanup_error;
+            }
+            
+            const char *name = NULL;
+            size_t name_len = 0;
+            const char *seq_start = NULL;
             
             // Try strict PHY format first (10 character names)
-            if (strlen(line) >= 10) {
-                strncpy(name_buffer, line, 10);
-                name_buffer[10] = '\0';
-                char *name = trim_whitespace(name_buffer);
-                
-                // Extract sequence data (everything after position 10)
-                char *seq_start = line + 10;
-                while (*seq_start && isspace(*seq_start)) seq_start++; // Skip whitespace
+            if (line_len >= STRICT_NAME_WIDTH) {
+                name_len = STRICT_NAME_WIDTH;
+                name = trim_whitespace(line, &name_len);
                 
-                if (*seq_start) {
-                    // Remove spaces from sequence
-                    char *seq_clean = seq_buffer;
-                    for (char *p = seq_start; *p; p++) {
-                        if (!isspace(*p)) {
-                            *seq_clean++ = *p;
-                        }
-                    }
-                    *seq_clean = '\0';
-                    
-                    // Store name and sequence
-                    sequence_names[current_seq] = strdup(name);
-                    strcpy(sequence_data[current_seq] + sequence_lengths[current_seq], seq_buffer);
-                    sequence_lengths[current_seq] += strlen(seq_buffer);
-                    current_seq++;
-                    
-                    if (current_seq > num_sequences) {
-                        fprintf(stderr, "Error: Too many sequences at line %d\n", line_num);
-                        free(seq_buffer);
-                        goto cleanup_error;
-                    }
-                    free(seq_buffer);
-                    continue;
-                }
+                // Sequence data is everything after position 10
+                seq_start = line + STRICT_NAME_WIDTH;
+                while (seq_start < line_end && isspace((unsigned char)*seq_start)) seq_start++;
+                if (seq_start == line_end) seq_start = NULL;
             }
             
             // Try relaxed format (space-separated name and sequence)
-            char *line_copy = strdup(line);
-            char *name = strtok(line_copy, " \t");
-            char *seq_part = strtok(NULL, "");
-            
-            if (name && seq_part) {
-                // Remove spaces from sequence
-                char *seq_clean = seq_buffer;
-                for (char *p = seq_part; *p; p++) {
-                    if (!isspace(*p)) {
-                        *seq_clean++ = *p;
-                    }
-                }
-                *seq_clean = '\0';
-                
-                // Store name and sequence
-                sequence_names[current_seq] = strdup(name);
-                strcpy(sequence_data[current_seq] + sequence_lengths[current_seq], seq_buffer);
-                sequence_lengths[current_seq] += strlen(seq_buffer);
-                current_seq++;
-                
-                if (current_seq > num_sequences) {
-                    fprintf(stderr, "Error: Too many sequences at line %d\n", line_num);
-                    free(line_copy);
-                    free(seq_buffer);
+            if (!seq_start) {
+                name = line;
+                while (name < line_end && (*name == ' ' || *name == '\t')) name++;
+                const char *q = name;
+                while (q < line_end && *q != ' ' && *q != '\t') q++;
+                name_len = q - name;
+                while (q < line_end && (*q == ' ' || *q == '\t')) q++;
+                if (name_len == 0 || q == line_end) {
+                    fprintf(stderr, "Error: Invalid sequence format at line %d\n", line_num);
                     goto cleanup_error;
                 }
-                
-                free(line_copy);
-                free(seq_buffer);
-                continue;
+                seq_start = q;
             }
             
-            free(line_copy);
-            fprintf(stderr, "Error: Invalid sequence format at line %d\n", line_num);
-            free(seq_buffer);
-            goto cleanup_error;
-            
+            // Store name and sequence
+            sequence_names[current_seq] = strndup(name, name_len);
+            append_residues(row, &sequence_lengths[current_seq], num_sites, seq_start, line_end);
+            current_seq++;
         } else {
             // Subsequent blocks in interleaved format - just sequence data
-            char *seq_clean = seq_buffer;
-            for (char *p = line; *p; p++) {
-                if (!isspace(*p)) {
-                    *seq_clean++ = *p;
-                }
-            }
-            *seq_clean = '\0';
-            
-            strcpy(sequence_data[current_seq] + sequence_lengths[current_seq], seq_buffer);
-            sequence_lengths[current_seq] += strlen(seq_buffer);
+            append_residues(row, &sequence_lengths[current_seq], num_sites, line, line_end);
             current_seq++;
             
             if (current_seq >= num_sequences) {
                 current_seq = 0;
             }
         }
-        
-        free(seq_buffer);
     }
     
     // Validate that we have all sequences
@@ -270,33 +178,53 @@ SeqList *parse_phy(const char *path) {
         goto cleanup_error;
     }
     
-    // Create final sequences
+    // Create final sequences, rows point into the shared matrix
+    SeqList *sl = seqlist_new(num_sequences);
+    if (!sl || arena_adopt(&sl->residues, matrix) != 0) {
+        fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+        seqlist_free(sl);
+        goto cleanup_error;
+    }
+    char *rows = matrix;
+    matrix = NULL;  // owned by the list now
+    
     for (int i = 0; i < num_sequences; i++) {
         if (!sequence_names[i]) {
             fprintf(stderr, "Error: Missing sequence name for sequence %d\n", i + 1);
+            seqlist_free(sl);
             goto cleanup_error;
         }
         
-        if (sequence_lengths[i] != num_sites) {
-            fprintf(stderr, "Error: Sequence '%s' has length %d, expected %d\n", 
+        if (sequence_lengths[i] != (size_t)num_sites) {
+            fprintf(stderr, "Error: Sequence '%s' has length %zu, expected %d\n", 
                     sequence_names[i], sequence_lengths[i], num_sites);
+            seqlist_free(sl);
             goto cleanup_error;
         }
         
-        sl->items[i].id = sequence_names[i];
-        sl->items[i].seq = sequence_data[i];
-        sl->items[i].len = sequence_lengths[i];
-        sl->items[i].type = detect_sequence_type(sequence_data[i], sequence_lengths[i]);
-        sl->count++;
+        long idx = seqlist_add(sl, sequence_names[i], strlen(sequence_names[i]));
+        if (idx < 0) {
+            fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+            seqlist_free(sl);
+            goto cleanup_error;
+        }
+        char *row = rows + (size_t)i * stride;
+        row[num_sites] = '\0';
+        sl->seqs[idx] = row;
+        sl->lens[idx] = num_sites;
     }
     
     // Clean up temporary arrays
+    for (int i = 0; i < num_sequences; i++) {
+        free(sequence_names[i]);
+    }
     free(sequence_names);
-    free(sequence_data);
     free(sequence_lengths);
-    free(line);
-    fclose(f);
+    mapped_file_close(&mf);
     
+    seqtype_classify_list(sl, SEQTYPE_SAMPLE_BYTES);
+    gapindex_list(sl);
+    nucpack_list(sl);
     return sl;
     
 cleanup_error:
@@ -307,20 +235,9 @@ cleanup_error:
         }
         free(sequence_names);
     }
-    if (sequence_data) {
-        for (int i = 0; i < num_sequences; i++) {
-            free(sequence_data[i]);
-        }
-        free(sequence_data);
-    }
     free(sequence_lengths);
-    free(line);
-    fclose(f);
-    
-    if (sl) {
-        free(sl->items);
-        free(sl);
-    }
+    free(matrix);
+    mapped_file_close(&mf);
     
     return NULL;
-} 
\ No newline at end of file
+}
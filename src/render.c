@@ -1,6 +1,48 @@
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "render.h"
+#include "frame.h"
+
+// Width of the sequence ID column, followed by the "| " separator
+#define ID_WIDTH 16
+
+// Cell styles, as the SGR parameters that draw them: a background color, plus black text for
+// search matches and inverse video for the selection. STYLE_PLAIN is the terminal default
+#define STYLE_PLAIN   0
+#define STYLE_BLACK   (1 << 8)
+#define STYLE_INVERSE (1 << 9)
+
+// Unchanged cells between two changed ones that are sent again rather than skipped with a
+// cursor move, which takes about as many bytes
+#define REWRITE_GAP 6
+
+// One screen cell: the UTF-8 bytes of its glyph and the style it is drawn in
+typedef struct {
+    char     glyph[4];
+    uint8_t  len;
+    uint16_t style;
+} Cell;
+
+// The cells on the terminal (front) and those of the frame being composed (back); a frame only
+// sends the cells that differ
+typedef struct {
+    Cell *front;
+    Cell *back;
+    int   rows;
+    int   cols;
+} Screen;
+
+static const Cell blank_cell = { { ' ' }, 1, STYLE_PLAIN };
+
+// What is on the terminal, whether something else may have drawn over it since, and the
+// first sequence row it shows
+static Screen scr;
+static bool scr_stale = true;
+static int shown_row_offset;
 
 // map bases -> ANSI background codes for DNA/RNA
 static int bg_for_nucleotide(char c) {
@@ -65,36 +107,109 @@ static int bg_for_amino_acid(char c) {
     }
 }
 
-// Helper function to get background color based on sequence type
-static int bg_for_sequence(char c, SequenceType type) {
-    switch (type) {
-        case SEQ_DNA:
-        case SEQ_RNA:
-            return bg_for_nucleotide(c);
-        case SEQ_PROTEIN:
-            return bg_for_amino_acid(c);
-        default:
-            return 100; // grey for unknown
+// Background of each byte for every sequence type, compiled from the schemes above; rows of
+// unknown type are drawn grey
+static uint8_t residue_bg[SEQ_UNKNOWN + 1][256];
+
+// SGR sequence of every cell style, indexed by its flags and background; the flags take the
+// bits above the background, which stays below 128
+#define STYLE_SLOTS (4 << 7)
+static char style_sgr[STYLE_SLOTS][16];
+static uint8_t style_sgr_len[STYLE_SLOTS];
+
+// Helper function to find the slot of a style in the SGR table
+static int style_slot(int style) {
+    return (style >> 8) << 7 | (style & 0x7f);
+}
+
+// Helper function to fill the color and escape tables, once
+static void build_color_tables(void) {
+    static bool built = false;
+    if (built) return;
+    for (int c = 0; c < 256; c++) {
+        residue_bg[SEQ_DNA][c] = (uint8_t)bg_for_nucleotide((char)c);
+        residue_bg[SEQ_RNA][c] = (uint8_t)bg_for_nucleotide((char)c);
+        residue_bg[SEQ_PROTEIN][c] = (uint8_t)bg_for_amino_acid((char)c);
+        residue_bg[SEQ_UNKNOWN][c] = 100;  // grey
+    }
+
+    // The reset that starts each sequence drops whatever the previous style had on, so one
+    // escape covers any change
+    for (int flags = 0; flags < 4; flags++) {
+        for (int bg = 0; bg < 128; bg++) {
+            int style = flags << 8 | bg;
+            int slot = style_slot(style);
+            int len = style == STYLE_PLAIN
+                ? snprintf(style_sgr[slot], sizeof(style_sgr[slot]), "\x1b[0m")
+                : snprintf(style_sgr[slot], sizeof(style_sgr[slot]), "\x1b[0;%s%s%dm",
+                           style & STYLE_INVERSE ? "7;" : "", style & STYLE_BLACK ? "30;" : "", bg);
+            style_sgr_len[slot] = (uint8_t)len;
+        }
+    }
+    built = true;
+}
+
+// Helper function to size the screen to the terminal; cleared is set when the size changed or
+// the screen went stale, as the terminal then has to be cleared and drawn again. Returns false when out of memory
+static bool screen_fit(Screen *scr, int rows, int cols, bool *cleared) {
+    if (rows < 0) rows = 0;
+    if (cols < 0) cols = 0;
+    *cleared = false;
+    if (!scr_stale && rows == scr->rows && cols == scr->cols) return true;
+
+    size_t n = (size_t)rows * cols;
+    Cell *front = realloc(scr->front, (n ? n : 1) * sizeof(Cell));
+    if (front) scr->front = front;
+    Cell *back = realloc(scr->back, (n ? n : 1) * sizeof(Cell));
+    if (back) scr->back = back;
+    if (!front || !back) return false;
+
+    scr->rows = rows;
+    scr->cols = cols;
+    for (size_t i = 0; i < n; i++) scr->front[i] = blank_cell;
+    scr_stale = false;
+    *cleared = true;
+    return true;
+}
+
+// Helper function to put text on a row from column *col on, one cell per UTF-8 character,
+// clipped at column end or the right edge
+static void put_text(Screen *scr, int row, int *col, int end, const char *text, size_t n, int style) {
+    Cell *line = scr->back + (size_t)row * scr->cols;
+    if (end > scr->cols) end = scr->cols;
+    for (size_t i = 0; i < n && *col < end; ) {
+        size_t len = 1;
+        while (i + len < n && len < 4 && ((unsigned char)text[i + len] & 0xc0) == 0x80) len++;
+        Cell *cell = &line[(*col)++];
+        memcpy(cell->glyph, text + i, len);
+        cell->len = (uint8_t)len;
+        cell->style = (uint16_t)style;
+        i += len;
+    }
+}
+
+// Helper function to put n copies of a single-byte glyph on a row from column *col on
+static void put_fill(Screen *scr, int row, int *col, char c, int n) {
+    Cell *line = scr->back + (size_t)row * scr->cols;
+    for (; n > 0 && *col < scr->cols; n--) {
+        Cell *cell = &line[(*col)++];
+        cell->glyph[0] = c;
+        cell->len = 1;
+        cell->style = STYLE_PLAIN;
     }
 }
 
 // Helper function to render the ruler at the top
-static void render_ruler(ViewState *vs) {
-    int id_width = 16;
+static void render_ruler(ViewState *vs, Screen *scr) {
     int separator_width = 2; // "| "
+    int col = 0;
     
     // Print spacing to match sequence ID width
-    for (int i = 0; i < id_width; i++) {
-        putchar(' ');
-    }
-    printf("| ");
+    put_fill(scr, 0, &col, ' ', ID_WIDTH);
+    put_text(scr, 0, &col, scr->cols, "| ", 2, STYLE_PLAIN);
     
     // Calculate available space for ruler
-    int avail = vs->cols - id_width - separator_width;
-    if (avail <= 0) {
-        printf("\x1b[K\n"); // clear to end of line
-        return;
-    }
+    int avail = vs->cols - ID_WIDTH - separator_width;
     
     // Generate ruler with position markers
     for (int i = 0; i < avail; i++) {
@@ -103,127 +218,107 @@ static void render_ruler(ViewState *vs) {
         if (seq_pos % 10 == 0) {
             // Vertical pipe at every 10th position, then number
             char pos_str[16];
-            snprintf(pos_str, sizeof(pos_str), "|%d", seq_pos);
+            int pos_len = snprintf(pos_str, sizeof(pos_str), "|%d", seq_pos);
             
             // Check if we have enough space to print the pipe and number
-            int pos_len = strlen(pos_str);
             if (i + pos_len <= avail) {
-                printf("%s", pos_str);
+                put_text(scr, 0, &col, scr->cols, pos_str, pos_len, STYLE_PLAIN);
                 i += pos_len - 1; // -1 because the loop will increment i
             } else {
-                putchar('|'); // Just print pipe if not enough space for number
+                put_fill(scr, 0, &col, '|', 1); // Just print pipe if not enough space for number
             }
         } else {
             // Regular position, print space
-            putchar(' ');
+            put_fill(scr, 0, &col, ' ', 1);
         }
     }
-    
-    printf("\x1b[K\n"); // clear to end of line
 }
 
-void render_frame(ViewState *vs) {
-    // re-hide cursor in case anything unhid it
-    printf("\x1b[?25l");
-    // move cursor home without clearing screen
-    printf("\x1b[H");
+// Helper function to switch to a cell style
+static void set_style(Frame *out, int style) {
+    int slot = style_slot(style);
+    frame_append(out, style_sgr[slot], style_sgr_len[slot]);
+}
 
-    // Render ruler at the top
-    render_ruler(vs);
+// Helper function to restyle the cells of a screen line that show residues [from, to) of the
+// alignment; the window starts at residue first
+static void restyle_span(Cell *cells, int first, int visible, int from, int to, int style) {
+    if (from < first) from = first;
+    if (to > first + visible) to = first + visible;
+    for (int pos = from; pos < to; pos++) cells[pos - first].style = (uint16_t)style;
+}
 
-    int content = vs->rows - 3;  // leave 3 lines for ruler, separator, and status
-    for (int line = 0; line < content; line++) {
-        int idx = vs->row_offset + line;
-        if (idx >= (int)vs->seqs->count) {
-            printf("\x1b[K\n");  // clear to end of line for empty rows
-            continue;
-        }
+// Helper function to put the visible residues of a row on a screen line from column *col on.
+// Colors come straight from the table of the row's type; the selection and search matches
+// are then laid over the spans they cover, matches last as they win
+static void render_residues(ViewState *vs, Screen *scr, int line, int *col, int idx,
+                            const char *window, int visible) {
+    if (visible > scr->cols - *col) visible = scr->cols - *col;
+    if (visible <= 0) return;
+    if (vs->no_color) {
+        put_text(scr, line, col, scr->cols, window, visible, STYLE_PLAIN);
+        return;
+    }
 
-        Sequence *s = &vs->seqs->items[idx];
-        // print ID with fixed width of 16 characters
-        size_t idlen = strcspn(s->id, "\n");
-        int id_width = 16;
-        
-        // Print ID with exactly 16 characters, replacing tabs/whitespace with spaces
-        int chars_printed = 0;
-        for (int i = 0; i < (int)idlen && chars_printed < id_width; i++) {
-            char c = s->id[i];
-            // Replace tabs and other whitespace with spaces
-            if (c == '\t' || c == '\r' || c == '\v' || c == '\f') {
-                putchar(' ');
-            } else {
-                putchar(c);
-            }
-            chars_printed++;
-        }
-        // Pad with spaces to reach exactly 16 characters
-        for (int pad = chars_printed; pad < id_width; pad++) {
-            putchar(' ');
+    // rows too short to classify on their own follow the alignment
+    SequenceType type = vs->seqs->types[idx];
+    if (type == SEQ_UNKNOWN) type = vs->seqs->type;
+    const uint8_t *bg = residue_bg[type <= SEQ_UNKNOWN ? type : SEQ_UNKNOWN];
+    Cell *cells = scr->back + (size_t)line * scr->cols + *col;
+    for (int k = 0; k < visible; k++) {
+        unsigned char c = (unsigned char)window[k];
+        cells[k].glyph[0] = (char)c;
+        cells[k].len = 1;
+        cells[k].style = bg[c];
+    }
+    *col += visible;
+
+    int first = vs->col_offset;
+    if (vs->has_selection) {
+        int top = vs->select_start_row < vs->select_end_row ? vs->select_start_row : vs->select_end_row;
+        int bottom = vs->select_start_row < vs->select_end_row ? vs->select_end_row : vs->select_start_row;
+        int left = vs->select_start_col < vs->select_end_col ? vs->select_start_col : vs->select_end_col;
+        int right = vs->select_start_col < vs->select_end_col ? vs->select_end_col : vs->select_start_col;
+        if (idx >= top && idx <= bottom) {
+            if (left < first) left = first;
+            if (right >= first + visible) right = first + visible - 1;
+            for (int pos = left; pos <= right; pos++) cells[pos - first].style |= STYLE_INVERSE;
         }
-        printf("| ");
+    }
 
-        // show sequence using remaining available space
-        int avail = vs->cols - id_width - 2;  // subtract ID width and "| " separator
-        if (avail < 0) avail = 0;  // ensure non-negative
-        if (avail > 0) {
-            int chars_printed = 0;
-            int current_bg = -1;  // track current background color
-            for (int i = vs->col_offset; i < (int)s->len && chars_printed < avail; i++) {
-                bool is_selected = view_is_selected(vs, idx, i);
-                bool is_search_match = view_is_search_match(vs, idx, i);
-                bool is_current_match = view_is_current_search_match(vs, idx, i);
-                
-                if (!vs->no_color) {
-                    int bg = bg_for_sequence(s->seq[i], s->type);
-                    
-                    if (is_selected) {
-                        // Use inverse video for selected characters
-                        printf("\x1b[7m");  // inverse video
-                        if (bg != current_bg) {
-                            printf("\x1b[%dm", bg);
-                            current_bg = bg;
-                        }
-                    } else if (is_current_match) {
-                        // Current search match - bright yellow background with black text
-                        printf("\x1b[0m");  // reset first
-                        printf("\x1b[103;30m");  // bright yellow bg, black text
-                        current_bg = -1;  // force reset after
-                    } else if (is_search_match) {
-                        // Other search matches - yellow background with black text
-                        printf("\x1b[0m");  // reset first
-                        printf("\x1b[43;30m");  // yellow bg, black text
-                        current_bg = -1;  // force reset after
-                    } else {
-                        if (current_bg == -1 || bg != current_bg) {
-                            printf("\x1b[0m");  // reset first
-                            printf("\x1b[%dm", bg);
-                            current_bg = bg;
-                        }
-                    }
-                }
-                putchar(s->seq[i]);
-                
-                if ((is_selected || is_search_match || is_current_match) && !vs->no_color) {
-                    printf("\x1b[0m");  // reset after special character
-                    current_bg = -1;
-                }
-                chars_printed++;
-            }
-            if (current_bg != -1 && !vs->no_color) {
-                printf("\x1b[0m");  // reset color at end of sequence
+    int query_len = (int)strlen(vs->search_buffer);
+    if (vs->search_matches == 0 || query_len == 0) return;
+    if (vs->search_matches <= 100) {
+        for (int i = 0; i < vs->search_matches; i++) {
+            const SearchMatch *m = &vs->search_results[i];
+            if (m->seq_idx == idx) {
+                restyle_span(cells, first, visible, m->pos, m->pos + query_len, 43 | STYLE_BLACK);  // yellow
             }
         }
-        printf("\x1b[K\n");  // clear to end of line and newline
     }
+    if (vs->search_current < vs->search_matches) {
+        const SearchMatch *m = &vs->search_results[vs->search_current];
+        if (m->seq_idx == idx) {
+            restyle_span(cells, first, visible, m->pos, m->pos + query_len, 103 | STYLE_BLACK);  // bright yellow
+        }
+    }
+}
 
-    // draw underscores on the second-to-last line
-    for (int i = 0; i < vs->cols; i++) putchar('_');
-    printf("\x1b[K\n");  // clear to end of line
+// Helper function to format the position part of the status line, with load progress if still loading
+static void format_position(ViewState *vs, int max_seq_len, char *out, size_t size) {
+    int first_visible_seq = vs->row_offset + 1;  // 1-based
+    int used = 0;
+    if (vs->load_percent >= 0) {
+        used = snprintf(out, size, "Loading %d%% ", vs->load_percent);
+    }
+    snprintf(out + used, size - used, "Pos:%d/%d %d/%zu seqs",
+             vs->col_offset + 1, max_seq_len, first_visible_seq, vs->seqs->count);
+}
 
-    // draw status on the last line
-    printf("\x1b[K");  // clear entire line first
+// Helper function to render the status line at the bottom
+static void render_status(ViewState *vs, Frame *out) {
     if (vs->jump_mode) {
-        printf("Jump to position: %s", vs->jump_buffer);
+        frame_printf(out, "Jump to position: %s", vs->jump_buffer);
     } else if (vs->search_mode) {
         int search_len = strlen(vs->search_buffer);
         
@@ -236,49 +331,44 @@ void render_frame(ViewState *vs) {
             
             if (vs->search_matches > 100) {
                 if (search_len >= 63) {
-                    printf("Search: %s [LIMIT] - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s [LIMIT] - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, seq_num, start_pos, end_pos);
                 } else if (search_len >= 50) {
-                    printf("Search: %s [%d/63] - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, search_len, seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s [%d/63] - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, search_len, seq_num, start_pos, end_pos);
                 } else {
-                    printf("Search: %s - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s - Too many matches, >100 seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, seq_num, start_pos, end_pos);
                 }
             } else {
                 if (search_len >= 63) {
-                    printf("Search: %s [LIMIT] - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, vs->search_current + 1, vs->search_matches, 
-                           seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s [LIMIT] - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, vs->search_current + 1, vs->search_matches, 
+                                 seq_num, start_pos, end_pos);
                 } else if (search_len >= 50) {
-                    printf("Search: %s [%d/63] - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, search_len, vs->search_current + 1, vs->search_matches, 
-                           seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s [%d/63] - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, search_len, vs->search_current + 1, vs->search_matches, 
+                                 seq_num, start_pos, end_pos);
                 } else {
-                    printf("Search: %s - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
-                           vs->search_buffer, vs->search_current + 1, vs->search_matches, 
-                           seq_num, start_pos, end_pos);
+                    frame_printf(out, "Search: %s - Match %d/%d seq%d:%d-%d - ←→ navigate, ESC quit", 
+                                 vs->search_buffer, vs->search_current + 1, vs->search_matches, 
+                                 seq_num, start_pos, end_pos);
                 }
             }
         } else if (search_len > 0) {
             if (search_len >= 63) {
-                printf("Search: %s [LIMIT] - No matches - ESC quit", vs->search_buffer);
+                frame_printf(out, "Search: %s [LIMIT] - No matches - ESC quit", vs->search_buffer);
             } else if (search_len >= 50) {
-                printf("Search: %s [%d/63] - No matches - ESC quit", vs->search_buffer, search_len);
+                frame_printf(out, "Search: %s [%d/63] - No matches - ESC quit", vs->search_buffer, search_len);
             } else {
-                printf("Search: %s - No matches - ESC quit", vs->search_buffer);
+                frame_printf(out, "Search: %s - No matches - ESC quit", vs->search_buffer);
             }
         } else {
-            printf("Search: %s - ESC quit", vs->search_buffer);
+            frame_printf(out, "Search: %s - ESC quit", vs->search_buffer);
         }
     } else if (vs->has_selection) {
         // find the maximum sequence length for position info
-        int max_seq_len = 0;
-        for (size_t i = 0; i < vs->seqs->count; i++) {
-            if ((int)vs->seqs->items[i].len > max_seq_len) {
-                max_seq_len = (int)vs->seqs->items[i].len;
-            }
-        }
+        int max_seq_len = (int)seqlist_max_len(vs->seqs);
         
         // Left side: selection status
         char left_info[100];
@@ -290,9 +380,7 @@ void render_frame(ViewState *vs) {
         
         // Right side: position info (same as normal mode)
         char right_info[100];
-        int first_visible_seq = vs->row_offset + 1;  // 1-based
-        snprintf(right_info, sizeof(right_info), "Pos:%d/%d %d/%zu seqs", 
-                 vs->col_offset + 1, max_seq_len, first_visible_seq, vs->seqs->count);
+        format_position(vs, max_seq_len, right_info, sizeof(right_info));
         
         // Calculate spacing for full-width right-alignment
         int left_len = strlen(left_info);
@@ -304,24 +392,17 @@ void render_frame(ViewState *vs) {
         if (spacing < 0) spacing = 0;  // Don't allow negative spacing
         
         // Print status line with both selection status and position
-        printf("%s%*s%s", left_info, spacing, "", right_info);
+        frame_printf(out, "%s%*s%s", left_info, spacing, "", right_info);
     } else {
         // find the maximum sequence length
-        int max_seq_len = 0;
-        for (size_t i = 0; i < vs->seqs->count; i++) {
-            if ((int)vs->seqs->items[i].len > max_seq_len) {
-                max_seq_len = (int)vs->seqs->items[i].len;
-            }
-        }
+        int max_seq_len = (int)seqlist_max_len(vs->seqs);
         
         // Left side: navigation info
         char left_info[] = "(Q) Quit (J) Jump (F) Find (Mouse) Select (←↑↓→/WASD) Navigate";
         
         // Right side: position info with first visible sequence
         char right_info[100];
-        int first_visible_seq = vs->row_offset + 1;  // 1-based
-        snprintf(right_info, sizeof(right_info), "Pos:%d/%d %d/%zu seqs", 
-                 vs->col_offset + 1, max_seq_len, first_visible_seq, vs->seqs->count);
+        format_position(vs, max_seq_len, right_info, sizeof(right_info));
         
         // Calculate spacing for full-width right-alignment
         int left_len = strlen(left_info);
@@ -335,8 +416,194 @@ void render_frame(ViewState *vs) {
         if (spacing < 0) spacing = 0;  // Don't allow negative spacing
         
         // Print status line with full-width spacing
-        printf("%s%*s%s", left_info, spacing, "", right_info);
+        frame_printf(out, "%s%*s%s", left_info, spacing, "", right_info);
+    }
+}
+
+// Helper function to check if two cells look the same
+static bool same_cell(const Cell *a, const Cell *b) {
+    return a->len == b->len && a->style == b->style && memcmp(a->glyph, b->glyph, a->len) == 0;
+}
+
+// Helper function to move lines top..bottom of the terminal up by delta rows (down when
+// negative) within a scroll region, so the lines already drawn are shifted by the terminal
+// itself and only those coming into view are left to send
+static void scroll_lines(Screen *scr, Frame *out, int top, int bottom, int delta) {
+    int lines = bottom - top + 1;
+    int shift = delta > 0 ? delta : -delta;
+    if (shift == 0 || shift >= lines) return;
+
+    // Scroll Up / Scroll Down within the region, then back to the whole screen
+    frame_printf(out, "\x1b[%d;%dr\x1b[%d%c\x1b[r", top + 1, bottom + 1, shift, delta > 0 ? 'S' : 'T');
+
+    // The terminal fills the lines it opens with blanks in the default style
+    size_t width = scr->cols;
+    Cell *region = scr->front + (size_t)top * width;
+    size_t kept = (size_t)(lines - shift) * width;
+    Cell *opened;
+    if (delta > 0) {
+        memmove(region, region + (size_t)shift * width, kept * sizeof(Cell));
+        opened = region + kept;
+    } else {
+        memmove(region + (size_t)shift * width, region, kept * sizeof(Cell));
+        opened = region;
+    }
+    for (size_t i = 0; i < (size_t)shift * width; i++) opened[i] = blank_cell;
+}
+
+// Helper function to send one cell, switching style first if it needs another
+static void send_cell(Frame *out, const Cell *cell, int *style) {
+    if (cell->style != *style) {
+        *style = cell->style;
+        set_style(out, *style);
+    }
+    frame_append(out, cell->glyph, cell->len);
+}
+
+// Helper function to send the cells of the back screen that differ from the front one, as
+// runs reached with cursor moves, and make the front match
+static void send_changes(Screen *scr, Frame *out) {
+    int style = STYLE_PLAIN;  // every frame leaves the terminal in the default style
+    for (int row = 0; row < scr->rows; row++) {
+        Cell *front = scr->front + (size_t)row * scr->cols;
+        Cell *back = scr->back + (size_t)row * scr->cols;
+
+        // Blank cells at the end of the line are cleared in one go
+        int blank_from = scr->cols;
+        while (blank_from > 0 && same_cell(&back[blank_from - 1], &blank_cell)) blank_from--;
+
+        int cursor = -1;  // column the cursor is at on this row, -1 if elsewhere
+        for (int col = 0; col < scr->cols; col++) {
+            if (same_cell(&front[col], &back[col])) continue;
+
+            if (col >= blank_from) {
+                if (cursor != col) frame_printf(out, "\x1b[%d;%dH", row + 1, col + 1);
+                if (style != STYLE_PLAIN) set_style(out, STYLE_PLAIN);
+                style = STYLE_PLAIN;
+                frame_puts(out, "\x1b[K");
+                for (int k = col; k < scr->cols; k++) front[k] = blank_cell;
+                break;
+            }
+
+            if (cursor >= 0 && col > cursor && col - cursor <= REWRITE_GAP) {
+                // Cheaper to send the unchanged cells in between again
+                for (int k = cursor; k < col; k++) send_cell(out, &back[k], &style);
+            } else if (cursor != col) {
+                frame_printf(out, "\x1b[%d;%dH", row + 1, col + 1);
+            }
+            send_cell(out, &back[col], &style);
+            front[col] = back[col];
+            // The cursor stays on the last column until the next character
+            cursor = col + 1 < scr->cols ? col + 1 : -1;
+        }
+    }
+    if (style != STYLE_PLAIN) set_style(out, STYLE_PLAIN);
+}
+
+// Size and time of the frames drawn so far
+static RenderStats stats;
+
+void render_invalidate(void) {
+    scr_stale = true;
+}
+
+const RenderStats *render_stats(void) {
+    return &stats;
+}
+
+void render_frame(ViewState *vs) {
+    // the frame and the visible part of one row are kept across frames
+    static Frame out, text;
+    static char *window = NULL;
+    static int window_cap = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    build_color_tables();
+    bool cleared;
+    if (!screen_fit(&scr, vs->rows, vs->cols, &cleared)) return;
+    for (size_t i = 0; i < (size_t)scr.rows * scr.cols; i++) scr.back[i] = blank_cell;
+
+    // Render ruler at the top
+    if (scr.rows > 0) render_ruler(vs, &scr);
+
+    int content = vs->rows - 3;  // leave 3 lines for ruler, separator, and status
+    for (int line = 0; line < content; line++) {
+        int idx = vs->row_offset + line;
+        if (idx >= (int)vs->seqs->count) continue;  // empty rows stay blank
+
+        const char *id = vs->seqs->ids[idx];
+        // print ID with fixed width of 16 characters
+        size_t idlen = strcspn(id, "\n");
+        int col = 0;
+        put_text(&scr, line + 1, &col, ID_WIDTH, id, idlen, STYLE_PLAIN);
+        
+        // Replace tabs and other whitespace with spaces
+        Cell *cells = scr.back + (size_t)(line + 1) * scr.cols;
+        for (int i = 0; i < col; i++) {
+            char c = cells[i].glyph[0];
+            if (c == '\t' || c == '\r' || c == '\v' || c == '\f') cells[i].glyph[0] = ' ';
+        }
+        // Pad with spaces to reach exactly 16 characters
+        put_fill(&scr, line + 1, &col, ' ', ID_WIDTH - col);
+        put_text(&scr, line + 1, &col, scr.cols, "| ", 2, STYLE_PLAIN);
+
+        // show sequence using remaining available space
+        int avail = vs->cols - ID_WIDTH - 2;  // subtract ID width and "| " separator
+        if (avail > 0) {
+            // fetch only the visible slice, rows may be decoded on demand
+            if (avail > window_cap) {
+                char *grown = realloc(window, avail);
+                if (!grown) continue;  // the row's residues stay blank
+                window = grown;
+                window_cap = avail;
+            }
+            int visible = (int)seqlist_fetch(vs->seqs, idx, vs->col_offset, avail, window);
+            render_residues(vs, &scr, line + 1, &col, idx, window, visible);
+        }
+    }
+
+    if (scr.rows >= 2) {
+        // draw underscores on the second-to-last line
+        int col = 0;
+        put_fill(&scr, scr.rows - 2, &col, '_', scr.cols);
+
+        // draw status on the last line
+        frame_reset(&text);
+        render_status(vs, &text);
+        col = 0;
+        put_text(&scr, scr.rows - 1, &col, scr.cols, text.data, text.size, STYLE_PLAIN);
     }
 
+    // Terminals with synchronized output show the changes at once; the cursor is hidden
+    // again in case anything unhid it
+    frame_reset(&out);
+    if (vs->sync_output) frame_puts(&out, "\x1b[?2026h");
+    frame_puts(&out, "\x1b[?25l");
+    if (cleared) frame_puts(&out, "\x1b[0m\x1b[2J");
+    size_t header = out.size;
+    if (!cleared) {
+        // Rows scrolled by a few lines are already on screen, only somewhere else
+        scroll_lines(&scr, &out, 1, content, vs->row_offset - shown_row_offset);
+    }
+    shown_row_offset = vs->row_offset;
+    send_changes(&scr, &out);
+    if (out.size == header && !cleared) {
+        // Frames that change nothing send nothing
+        frame_reset(&out);
+    } else if (vs->sync_output) {
+        frame_puts(&out, "\x1b[?2026l");
+    }
+
+    // anything still buffered in stdio goes out ahead of the frame
     fflush(stdout);
-}
\ No newline at end of file
+    if (out.size > 0) frame_write(&out, STDOUT_FILENO);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long ns = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    stats.frames++;
+    stats.bytes += out.size;
+    stats.time_ns += ns;
+    if (out.size > stats.max_bytes) stats.max_bytes = out.size;
+    if (ns > stats.max_time_ns) stats.max_time_ns = ns;
+}
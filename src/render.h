@@ -1,4 +1,20 @@
 #pragma once
+#include <stddef.h>
 #include "view.h"
 
-void render_frame(ViewState *vs);
\ No newline at end of file
+// Size and time of the frames drawn so far, from composing through sending
+typedef struct {
+    size_t    frames;
+    size_t    bytes;
+    size_t    max_bytes;
+    long long time_ns;
+    long long max_time_ns;
+} RenderStats;
+
+// Draw the view, sending only the cells that changed since the last frame
+void render_frame(ViewState *vs);
+
+// Redraw the whole screen on the next frame, after something else may have written to the terminal
+void render_invalidate(void);
+
+const RenderStats *render_stats(void);
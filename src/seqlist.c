@@ -0,0 +1,158 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "seqlist.h"
+#include "nucpack.h"
+#include "gapindex.h"
+
+#define NAMES_CHUNK    (64u << 10)
+#define RESIDUES_CHUNK (1u << 20)
+
+// Helper function to resize every per-row array to the given capacity
+static int grow_rows(SeqList *sl, size_t capacity) {
+    char **ids = realloc(sl->ids, capacity * sizeof(*ids));
+    if (!ids) return -1;
+    sl->ids = ids;
+    char **seqs = realloc(sl->seqs, capacity * sizeof(*seqs));
+    if (!seqs) return -1;
+    sl->seqs = seqs;
+    size_t *lens = realloc(sl->lens, capacity * sizeof(*lens));
+    if (!lens) return -1;
+    sl->lens = lens;
+    SequenceType *types = realloc(sl->types, capacity * sizeof(*types));
+    if (!types) return -1;
+    sl->types = types;
+    if (sl->packed) {
+        PackedRow **packed = realloc(sl->packed, capacity * sizeof(*packed));
+        if (!packed) return -1;
+        sl->packed = packed;
+    }
+    if (sl->gaps) {
+        GapIndex **gaps = realloc(sl->gaps, capacity * sizeof(*gaps));
+        if (!gaps) return -1;
+        sl->gaps = gaps;
+    }
+    sl->capacity = capacity;
+    return 0;
+}
+
+SeqList *seqlist_new(size_t capacity) {
+    SeqList *sl = calloc(1, sizeof(*sl));
+    if (!sl) return NULL;
+    arena_init(&sl->names, NAMES_CHUNK);
+    arena_init(&sl->residues, RESIDUES_CHUNK);
+    arena_init(&sl->meta, NAMES_CHUNK);
+    sl->type = SEQ_UNKNOWN;
+    if (grow_rows(sl, capacity ? capacity : 16) != 0) {
+        seqlist_free(sl);
+        return NULL;
+    }
+    return sl;
+}
+
+long seqlist_add(SeqList *sl, const char *name, size_t name_len) {
+    if (sl->count == sl->capacity && grow_rows(sl, sl->capacity * 2) != 0) return -1;
+
+    char *id = arena_strndup(&sl->names, name, name_len);
+    if (!id) return -1;
+
+    size_t row = sl->count++;
+    sl->ids[row] = id;
+    sl->seqs[row] = NULL;
+    sl->lens[row] = 0;
+    sl->types[row] = SEQ_UNKNOWN;
+    if (sl->packed) sl->packed[row] = NULL;
+    if (sl->gaps) sl->gaps[row] = NULL;
+    return (long)row;
+}
+
+size_t seqlist_max_len(const SeqList *sl) {
+    size_t max_len = 0;
+    for (size_t i = 0; i < sl->count; i++) {
+        if (sl->lens[i] > max_len) max_len = sl->lens[i];
+    }
+    return max_len;
+}
+
+size_t seqlist_stored_len(const SeqList *sl, size_t row) {
+    GapIndex *gi = sl->gaps ? sl->gaps[row] : NULL;
+    return gi ? sl->lens[row] - gi->total : sl->lens[row];
+}
+
+const char *seqlist_row_text(const SeqList *sl, size_t row) {
+    if (sl->gaps && sl->gaps[row]) return NULL;
+    return sl->seqs[row];
+}
+
+size_t seqlist_skip_gaps(const SeqList *sl, size_t row, size_t col) {
+    GapIndex *gi = sl->gaps ? sl->gaps[row] : NULL;
+    return gi ? gapindex_next_residue(gi, col) : col;
+}
+
+// Helper function to copy n residues of a row's own storage, starting at stored position start
+static void fetch_stored(SeqList *sl, size_t row, size_t start, size_t n, char *out) {
+    if (sl->seqs[row]) {
+        memcpy(out, sl->seqs[row] + start, n);
+    } else {
+        nucpack_decode(sl->packed[row], start, n, out);
+    }
+}
+
+size_t seqlist_fetch(SeqList *sl, size_t row, size_t start, size_t n, char *out) {
+    if (row >= sl->count) return 0;
+
+    size_t len = sl->lens[row];
+    if (start >= len) return 0;
+    if (n > len - start) n = len - start;
+
+    bool resident = sl->seqs[row] || (sl->packed && sl->packed[row]);
+    if (!resident) {
+        return sl->source ? sl->source->fetch(sl->source, row, start, n, out) : 0;
+    }
+
+    GapIndex *gi = sl->gaps ? sl->gaps[row] : NULL;
+    if (!gi) {
+        fetch_stored(sl, row, start, n, out);
+        return n;
+    }
+
+    // Alternate between gap runs and the residues stored between them
+    size_t k = gapindex_find(gi, start);
+    size_t stored = gapindex_residues_before(gi, start);
+    size_t col = start, stop = start + n;
+    while (col < stop) {
+        if (k < gi->count && gi->start[k] <= col) {
+            size_t run_end = gi->start[k] + gi->length[k];
+            size_t e = run_end < stop ? run_end : stop;
+            memset(out + (col - start), '-', e - col);
+            col = e;
+            k++;
+        } else {
+            size_t e = k < gi->count && gi->start[k] < stop ? gi->start[k] : stop;
+            fetch_stored(sl, row, stored, e - col, out + (col - start));
+            stored += e - col;
+            col = e;
+        }
+    }
+    return n;
+}
+
+void seqlist_free(SeqList *sl) {
+    if (!sl) return;
+
+    // Rows own nothing themselves, so teardown does not depend on the row count
+    free(sl->ids);
+    free(sl->seqs);
+    free(sl->lens);
+    free(sl->types);
+    free(sl->packed);
+    free(sl->gaps);
+    arena_free(&sl->names);
+    arena_free(&sl->residues);
+    arena_free(&sl->meta);
+    if (sl->source) {
+        sl->source->destroy(sl->source);
+    }
+    mapped_file_close(&sl->backing);
+    free(sl);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "mapped_file.h"
+
+typedef enum {
+    SEQ_DNA,
+    SEQ_RNA,
+    SEQ_PROTEIN,
+    SEQ_UNKNOWN
+} SequenceType;
+
+// Nucleotide row kept in packed form (see nucpack.h)
+typedef struct PackedRow PackedRow;
+
+// Gap runs of a row (see gapindex.h)
+typedef struct GapIndex GapIndex;
+
+// Backend for rows whose residues are decoded on demand instead of kept in memory
+typedef struct SeqSource SeqSource;
+struct SeqSource {
+    // Copy up to n residues of a row, starting at column start, into out; returns the count copied
+    size_t (*fetch)(SeqSource *src, size_t row, size_t start, size_t n, char *out);
+    void   (*destroy)(SeqSource *src);
+    // Write what is needed to reopen the source without parsing (NULL if unsupported)
+    int    (*save)(SeqSource *src, FILE *out);
+};
+
+typedef struct {
+    size_t count, capacity;
+
+    // One parallel array per row field, so a loop over one field touches nothing else
+    char        **ids;
+    char        **seqs;   // residues, or NULL when the row is packed or served by the list's source
+    size_t       *lens;
+    SequenceType *types;
+    PackedRow   **packed; // packed residues per row (NULL until the list is packed)
+    GapIndex    **gaps;   // gap runs per row (NULL until any row has them); a resident row
+                          // with an index stores only its residues
+
+    Arena names;          // storage for every id
+    Arena residues;       // storage for every resident row
+    Arena meta;           // per-row indexes such as gap runs, which outlive residue repacking
+    SeqSource *source;    // serves rows whose seq is NULL (NULL if every row is resident)
+    MappedFile backing;   // file the rows point into when loaded from a cache (data NULL otherwise)
+    SequenceType type;    // alignment-wide type decided from the counts of all rows
+} SeqList;
+
+// Create an empty list with room for capacity rows; returns NULL when out of memory
+SeqList *seqlist_new(size_t capacity);
+
+// Append a row named name[0..name_len) with no residues yet; returns its index, or -1 when out of memory
+long seqlist_add(SeqList *sl, const char *name, size_t name_len);
+
+// Number of residues a resident row actually stores (its length minus indexed gaps)
+size_t seqlist_stored_len(const SeqList *sl, size_t row);
+
+// The full text of a row if it is kept as plain characters, otherwise NULL
+const char *seqlist_row_text(const SeqList *sl, size_t row);
+
+// First column at or after col that may hold a residue (col itself if the row has no gap index)
+size_t seqlist_skip_gaps(const SeqList *sl, size_t row, size_t col);
+
+// Length of the longest row
+size_t seqlist_max_len(const SeqList *sl);
+
+// Copy residues [start, start + n) of a row into out, clipped to the row length
+size_t seqlist_fetch(SeqList *sl, size_t row, size_t start, size_t n, char *out);
+
+// Free the list, its rows and its source
+void seqlist_free(SeqList *sl);
@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include "seqscan.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// Every vector kernel below returns the length of the longest prefix, in whole vectors,
+// that contains no "hit" byte. The next narrower kernel (and finally the scalar loop)
+// then continues from there, so each level looks at no more than one extra vector.
+
+// ---------------------------------------------------------------------------
+// Scalar building blocks
+
+// Class bits of every byte value, so the scalar loops need one table load per byte
+enum {
+    CLS_SPACE  = 1 << 0,
+    CLS_LETTER = 1 << 1,
+    CLS_ACG    = 1 << 2,
+    CLS_T      = 1 << 3,
+    CLS_U      = 1 << 4,
+    CLS_NX     = 1 << 5,
+    CLS_GAP    = 1 << 6,
+    CLS_STOP   = 1 << 7,
+    CLS_ANGLE  = 1 << 8
+};
+
+#define LETTER_PAIR(up, bits) [up] = CLS_LETTER | (bits), [(up) | 0x20] = CLS_LETTER | (bits)
+
+static const uint16_t byte_class[256] = {
+    [' '] = CLS_SPACE, ['\t'] = CLS_SPACE, ['\n'] = CLS_SPACE,
+    ['\v'] = CLS_SPACE, ['\f'] = CLS_SPACE, ['\r'] = CLS_SPACE,
+    LETTER_PAIR('A', CLS_ACG), LETTER_PAIR('B', 0), LETTER_PAIR('C', CLS_ACG),
+    LETTER_PAIR('D', 0), LETTER_PAIR('E', 0), LETTER_PAIR('F', 0),
+    LETTER_PAIR('G', CLS_ACG), LETTER_PAIR('H', 0), LETTER_PAIR('I', 0),
+    LETTER_PAIR('J', 0), LETTER_PAIR('K', 0), LETTER_PAIR('L', 0),
+    LETTER_PAIR('M', 0), LETTER_PAIR('N', CLS_NX), LETTER_PAIR('O', 0),
+    LETTER_PAIR('P', 0), LETTER_PAIR('Q', 0), LETTER_PAIR('R', 0),
+    LETTER_PAIR('S', 0), LETTER_PAIR('T', CLS_T), LETTER_PAIR('U', CLS_U),
+    LETTER_PAIR('V', 0), LETTER_PAIR('W', 0), LETTER_PAIR('X', CLS_NX),
+    LETTER_PAIR('Y', 0), LETTER_PAIR('Z', 0),
+    ['-'] = CLS_GAP, ['.'] = CLS_GAP, ['*'] = CLS_STOP, ['<'] = CLS_ANGLE, ['>'] = CLS_ANGLE
+};
+
+#undef LETTER_PAIR
+
+static inline bool is_space_byte(unsigned char c) {
+    return byte_class[c] & CLS_SPACE;
+}
+
+static inline bool is_residue_byte(unsigned char c) {
+    return byte_class[c] != 0;
+}
+
+static void count_scalar(const unsigned char *p, size_t n, ResidueCounts *rc) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned f = byte_class[p[i]];
+        rc->space   += (f & CLS_SPACE) != 0;
+        rc->letters += (f & CLS_LETTER) != 0;
+        rc->acg     += (f & CLS_ACG) != 0;
+        rc->t       += (f & CLS_T) != 0;
+        rc->u       += (f & CLS_U) != 0;
+        rc->nx      += (f & CLS_NX) != 0;
+        rc->gaps    += (f & CLS_GAP) != 0;
+        rc->stops   += (f & CLS_STOP) != 0;
+        rc->angles  += (f & CLS_ANGLE) != 0;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels (16 bytes per step)
+
+#ifdef SCAN_SSE2
+static inline __m128i sse2_in_range(__m128i v, char lo, char span) {
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(span)), t);
+}
+
+static inline __m128i sse2_is_space(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), sse2_in_range(v, '\t', '\r' - '\t'));
+}
+
+static inline __m128i sse2_is_letter(__m128i v) {
+    return sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z' - 'a');
+}
+
+static inline __m128i sse2_eq(__m128i v, char c) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+static inline __m128i sse2_is_residue(__m128i v) {
+    __m128i ok = _mm_or_si128(sse2_is_letter(v), sse2_is_space(v));
+    ok = _mm_or_si128(ok, _mm_or_si128(sse2_eq(v, '-'), sse2_eq(v, '.')));
+    ok = _mm_or_si128(ok, _mm_or_si128(sse2_eq(v, '*'), sse2_eq(v, '<')));
+    return _mm_or_si128(ok, sse2_eq(v, '>'));
+}
+
+static inline __m128i sse2_load(const unsigned char *p) {
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static size_t blank_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (_mm_movemask_epi8(sse2_is_space(sse2_load(p + i))) != 0xFFFF) break;
+    }
+    return i;
+}
+
+static size_t residue_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (_mm_movemask_epi8(sse2_is_residue(sse2_load(p + i))) != 0xFFFF) break;
+    }
+    return i;
+}
+
+static size_t find_space_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (_mm_movemask_epi8(sse2_is_space(sse2_load(p + i))) != 0) break;
+    }
+    return i;
+}
+
+static size_t find_eol_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = sse2_load(p + i);
+        if (_mm_movemask_epi8(_mm_or_si128(sse2_eq(v, '\n'), sse2_eq(v, '\r'))) != 0) break;
+    }
+    return i;
+}
+
+static uint64_t sse2_sum(__m128i acc) {
+    __m128i s = _mm_sad_epu8(acc, _mm_setzero_si128());
+    return (uint64_t)_mm_cvtsi128_si32(s) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+}
+
+static size_t count_sse2(const unsigned char *p, size_t n, ResidueCounts *rc) {
+    size_t i = 0;
+    const __m128i upper_mask = _mm_set1_epi8((char)0xDF);
+    while (n - i >= 16) {
+        // 8-bit lane counters overflow after 255 steps, flush them before that
+        size_t steps = (n - i) / 16;
+        if (steps > 255) steps = 255;
+        __m128i space = _mm_setzero_si128(), letters = space, acg = space, t = space, u = space;
+        __m128i nx = space, gaps = space, stops = space, angles = space;
+        for (size_t s = 0; s < steps; s++, i += 16) {
+            __m128i v = sse2_load(p + i);
+            __m128i up = _mm_and_si128(v, upper_mask);
+            // cmpeq yields -1 per matching lane, subtracting it counts up
+            space   = _mm_sub_epi8(space, sse2_is_space(v));
+            letters = _mm_sub_epi8(letters, sse2_is_letter(v));
+            acg     = _mm_sub_epi8(acg, _mm_or_si128(_mm_or_si128(sse2_eq(up, 'A'), sse2_eq(up, 'C')), sse2_eq(up, 'G')));
+            t       = _mm_sub_epi8(t, sse2_eq(up, 'T'));
+            u       = _mm_sub_epi8(u, sse2_eq(up, 'U'));
+            nx      = _mm_sub_epi8(nx, _mm_or_si128(sse2_eq(up, 'N'), sse2_eq(up, 'X')));
+            gaps    = _mm_sub_epi8(gaps, _mm_or_si128(sse2_eq(v, '-'), sse2_eq(v, '.')));
+            stops   = _mm_sub_epi8(stops, sse2_eq(v, '*'));
+            angles  = _mm_sub_epi8(angles, _mm_or_si128(sse2_eq(v, '<'), sse2_eq(v, '>')));
+        }
+        rc->space += sse2_sum(space);
+        rc->letters += sse2_sum(letters);
+        rc->acg += sse2_sum(acg);
+        rc->t += sse2_sum(t);
+        rc->u += sse2_sum(u);
+        rc->nx += sse2_sum(nx);
+        rc->gaps += sse2_sum(gaps);
+        rc->stops += sse2_sum(stops);
+        rc->angles += sse2_sum(angles);
+    }
+    return i;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels (32 bytes per step), selected at run time
+
+#ifdef SCAN_AVX2
+static bool cpu_has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+AVX2_TARGET static inline __m256i avx2_in_range(__m256i v, char lo, char span) {
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(span)), t);
+}
+
+AVX2_TARGET static inline __m256i avx2_is_space(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), avx2_in_range(v, '\t', '\r' - '\t'));
+}
+
+AVX2_TARGET static inline __m256i avx2_is_letter(__m256i v) {
+    return avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a');
+}
+
+AVX2_TARGET static inline __m256i avx2_eq(__m256i v, char c) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+AVX2_TARGET static inline __m256i avx2_is_residue(__m256i v) {
+    __m256i ok = _mm256_or_si256(avx2_is_letter(v), avx2_is_space(v));
+    ok = _mm256_or_si256(ok, _mm256_or_si256(avx2_eq(v, '-'), avx2_eq(v, '.')));
+    ok = _mm256_or_si256(ok, _mm256_or_si256(avx2_eq(v, '*'), avx2_eq(v, '<')));
+    return _mm256_or_si256(ok, avx2_eq(v, '>'));
+}
+
+AVX2_TARGET static inline __m256i avx2_load(const unsigned char *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+
+AVX2_TARGET static size_t blank_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        if ((uint32_t)_mm256_movemask_epi8(avx2_is_space(avx2_load(p + i))) != 0xFFFFFFFFu) break;
+    }
+    return i;
+}
+
+AVX2_TARGET static size_t residue_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        if ((uint32_t)_mm256_movemask_epi8(avx2_is_residue(avx2_load(p + i))) != 0xFFFFFFFFu) break;
+    }
+    return i;
+}
+
+AVX2_TARGET static size_t find_space_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        if (_mm256_movemask_epi8(avx2_is_space(avx2_load(p + i))) != 0) break;
+    }
+    return i;
+}
+
+AVX2_TARGET static size_t find_eol_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = avx2_load(p + i);
+        if (_mm256_movemask_epi8(_mm256_or_si256(avx2_eq(v, '\n'), avx2_eq(v, '\r'))) != 0) break;
+    }
+    return i;
+}
+
+AVX2_TARGET static uint64_t avx2_sum(__m256i acc) {
+    __m256i s = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, s);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+AVX2_TARGET static size_t count_avx2(const unsigned char *p, size_t n, ResidueCounts *rc) {
+    size_t i = 0;
+    const __m256i upper_mask = _mm256_set1_epi8((char)0xDF);
+    while (n - i >= 32) {
+        // 8-bit lane counters overflow after 255 steps, flush them before that
+        size_t steps = (n - i) / 32;
+        if (steps > 255) steps = 255;
+        __m256i space = _mm256_setzero_si256(), letters = space, acg = space, t = space, u = space;
+        __m256i nx = space, gaps = space, stops = space, angles = space;
+        for (size_t s = 0; s < steps; s++, i += 32) {
+            __m256i v = avx2_load(p + i);
+            __m256i up = _mm256_and_si256(v, upper_mask);
+            space   = _mm256_sub_epi8(space, avx2_is_space(v));
+            letters = _mm256_sub_epi8(letters, avx2_is_letter(v));
+            acg     = _mm256_sub_epi8(acg, _mm256_or_si256(_mm256_or_si256(avx2_eq(up, 'A'), avx2_eq(up, 'C')), avx2_eq(up, 'G')));
+            t       = _mm256_sub_epi8(t, avx2_eq(up, 'T'));
+            u       = _mm256_sub_epi8(u, avx2_eq(up, 'U'));
+            nx      = _mm256_sub_epi8(nx, _mm256_or_si256(avx2_eq(up, 'N'), avx2_eq(up, 'X')));
+            gaps    = _mm256_sub_epi8(gaps, _mm256_or_si256(avx2_eq(v, '-'), avx2_eq(v, '.')));
+            stops   = _mm256_sub_epi8(stops, avx2_eq(v, '*'));
+            angles  = _mm256_sub_epi8(angles, _mm256_or_si256(avx2_eq(v, '<'), avx2_eq(v, '>')));
+        }
+        rc->space += avx2_sum(space);
+        rc->letters += avx2_sum(letters);
+        rc->acg += avx2_sum(acg);
+        rc->t += avx2_sum(t);
+        rc->u += avx2_sum(u);
+        rc->nx += avx2_sum(nx);
+        rc->gaps += avx2_sum(gaps);
+        rc->stops += avx2_sum(stops);
+        rc->angles += avx2_sum(angles);
+    }
+    return i;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Public entry points: widest kernel first, then narrower ones, then scalar
+
+bool scan_is_blank(const char *p, size_t n) {
+    const unsigned char *s = (const unsigned char *)p;
+    size_t i = 0;
+#ifdef SCAN_AVX2
+    if (cpu_has_avx2()) i += blank_avx2(s, n);
+#endif
+#ifdef SCAN_SSE2
+    i += blank_sse2(s + i, n - i);
+#endif
+    for (; i < n; i++) {
+        if (!is_space_byte(s[i])) return false;
+    }
+    return true;
+}
+
+bool scan_is_residue_text(const char *p, size_t n) {
+    const unsigned char *s = (const unsigned char *)p;
+    size_t i = 0;
+#ifdef SCAN_AVX2
+    if (cpu_has_avx2()) i += residue_avx2(s, n);
+#endif
+#ifdef SCAN_SSE2
+    i += residue_sse2(s + i, n - i);
+#endif
+    for (; i < n; i++) {
+        if (!is_residue_byte(s[i])) return false;
+    }
+    return true;
+}
+
+size_t scan_find_space(const char *p, size_t n) {
+    const unsigned char *s = (const unsigned char *)p;
+    size_t i = 0;
+#ifdef SCAN_AVX2
+    if (cpu_has_avx2()) i += find_space_avx2(s, n);
+#endif
+#ifdef SCAN_SSE2
+    i += find_space_sse2(s + i, n - i);
+#endif
+    while (i < n && !is_space_byte(s[i])) i++;
+    return i;
+}
+
+size_t scan_find_eol(const char *p, size_t n) {
+    const unsigned char *s = (const unsigned char *)p;
+    size_t i = 0;
+#ifdef SCAN_AVX2
+    if (cpu_has_avx2()) i += find_eol_avx2(s, n);
+#endif
+#ifdef SCAN_SSE2
+    i += find_eol_sse2(s + i, n - i);
+#endif
+    while (i < n && s[i] != '\n' && s[i] != '\r') i++;
+    return i;
+}
+
+void scan_count_residues(const char *p, size_t n, ResidueCounts *rc) {
+    const unsigned char *s = (const unsigned char *)p;
+    size_t i = 0;
+#ifdef SCAN_AVX2
+    if (cpu_has_avx2()) i += count_avx2(s, n, rc);
+#endif
+#ifdef SCAN_SSE2
+    i += count_sse2(s + i, n - i, rc);
+#endif
+    count_scalar(s + i, n - i, rc);
+    rc->bytes += n;
+}
+
+void scan_add_counts(ResidueCounts *dst, const ResidueCounts *src) {
+    dst->bytes   += src->bytes;
+    dst->space   += src->space;
+    dst->letters += src->letters;
+    dst->acg     += src->acg;
+    dst->t       += src->t;
+    dst->u       += src->u;
+    dst->nx      += src->nx;
+    dst->gaps    += src->gaps;
+    dst->stops   += src->stops;
+    dst->angles  += src->angles;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+
+// Byte-level scanning kernels shared by all parsers.
+// Each runs in one linear pass, using AVX2 or SSE2 when available and a scalar loop otherwise.
+
+// Per-class byte counts of a residue string
+typedef struct {
+    size_t bytes;    // bytes scanned
+    size_t space;    // ' ', '\t', '\n', '\v', '\f', '\r'
+    size_t letters;  // A-Z, a-z
+    size_t acg;      // A, C, G in either case
+    size_t t;        // T, t
+    size_t u;        // U, u
+    size_t nx;       // N, X in either case
+    size_t gaps;     // '-', '.'
+    size_t stops;    // '*'
+    size_t angles;   // '<', '>'
+} ResidueCounts;
+
+// True if every byte is whitespace (also for an empty range)
+bool scan_is_blank(const char *p, size_t n);
+
+// True if every byte may appear on a sequence line: letters, gaps, '*', '<', '>' and whitespace
+bool scan_is_residue_text(const char *p, size_t n);
+
+// Index of the first whitespace byte, or n if there is none
+size_t scan_find_space(const char *p, size_t n);
+
+// Index of the first '\r' or '\n', or n if there is none
+size_t scan_find_eol(const char *p, size_t n);
+
+// Add the class counts of p[0..n) to rc
+void scan_count_residues(const char *p, size_t n, ResidueCounts *rc);
+
+// Add the counts in src to dst
+void scan_add_counts(ResidueCounts *dst, const ResidueCounts *src);
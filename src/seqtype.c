@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include "seqtype.h"
+#include "workpool.h"
+
+#define SEQTYPE_SAMPLE_WINDOWS 16
+#define SEQTYPE_ROWS_PER_TASK  64
+
+SequenceType seqtype_from_counts(const ResidueCounts *rc) {
+    // Skip gaps, unknowns, and special characters
+    size_t total_chars = rc->bytes - rc->space - rc->nx - rc->gaps - rc->stops - rc->angles;
+    size_t dna_chars = rc->acg + rc->t;  // A, C, G, T
+    size_t rna_chars = rc->acg + rc->u;  // A, C, G, U
+
+    // Need at least 4 characters to make a reliable determination
+    if (total_chars < 4) return SEQ_UNKNOWN;
+
+    double dna_pct = (double)dna_chars / total_chars;
+    double rna_pct = (double)rna_chars / total_chars;
+
+    // If 95% or more of characters are DNA bases, it's DNA (unless it contains U)
+    if (dna_pct >= 0.95) {
+        return rc->u ? SEQ_RNA : SEQ_DNA;
+    }
+
+    // If 95% or more of characters are RNA bases and contains U, it's RNA
+    if (rna_pct >= 0.95 && rc->u) {
+        return SEQ_RNA;
+    }
+
+    // Otherwise, assume it's protein
+    return SEQ_PROTEIN;
+}
+
+void seqtype_count(const char *seq, size_t len, size_t sample_cap, ResidueCounts *rc) {
+    if (sample_cap == 0 || len <= sample_cap) {
+        scan_count_residues(seq, len, rc);
+        return;
+    }
+
+    size_t window = sample_cap / SEQTYPE_SAMPLE_WINDOWS;
+    if (window == 0) window = 1;
+    size_t windows = sample_cap / window;
+    size_t stride = (len - window) / (windows > 1 ? windows - 1 : 1);
+    for (size_t w = 0; w < windows; w++) {
+        scan_count_residues(seq + w * stride, window, rc);
+    }
+}
+
+SequenceType seqtype_classify(const char *seq, size_t len, size_t sample_cap) {
+    if (len == 0) return SEQ_UNKNOWN;
+    ResidueCounts rc = {0};
+    seqtype_count(seq, len, sample_cap, &rc);
+    return seqtype_from_counts(&rc);
+}
+
+typedef struct {
+    SeqList *sl;
+    size_t sample_cap;
+    ResidueCounts *partial;  // combined counts of each task
+} ClassifyJob;
+
+// Helper function to classify one range of rows
+static void classify_rows(size_t begin, size_t end, void *arg) {
+    ClassifyJob *job = arg;
+    ResidueCounts *sum = &job->partial[begin / SEQTYPE_ROWS_PER_TASK];
+    for (size_t i = begin; i < end; i++) {
+        const char *seq = job->sl->seqs[i];
+        size_t len = job->sl->lens[i];
+        if (!seq) continue;
+        ResidueCounts rc = {0};
+        seqtype_count(seq, len, job->sample_cap, &rc);
+        job->sl->types[i] = len ? seqtype_from_counts(&rc) : SEQ_UNKNOWN;
+
+        scan_add_counts(sum, &rc);
+    }
+}
+
+void seqtype_classify_list(SeqList *sl, size_t sample_cap) {
+    size_t tasks = (sl->count + SEQTYPE_ROWS_PER_TASK - 1) / SEQTYPE_ROWS_PER_TASK;
+    ClassifyJob job = { sl, sample_cap, calloc(tasks ? tasks : 1, sizeof(ResidueCounts)) };
+    if (!job.partial) {
+        // Out of memory for the tallies: still classify the rows, one at a time
+        for (size_t i = 0; i < sl->count; i++) {
+            if (sl->seqs[i]) sl->types[i] = seqtype_classify(sl->seqs[i], sl->lens[i], sample_cap);
+        }
+        sl->type = SEQ_UNKNOWN;
+        return;
+    }
+
+    workpool_run(sl->count, SEQTYPE_ROWS_PER_TASK, classify_rows, &job);
+
+    // Sum the tallies in task order so the result does not depend on scheduling
+    ResidueCounts total = {0};
+    for (size_t k = 0; k < tasks; k++) {
+        scan_add_counts(&total, &job.partial[k]);
+    }
+    free(job.partial);
+    sl->type = seqtype_from_counts(&total);
+}
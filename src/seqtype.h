@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include "seqlist.h"
+#include "seqscan.h"
+
+// Bytes inspected per row when classifying a whole list; longer rows are sampled
+#define SEQTYPE_SAMPLE_BYTES ((size_t)1 << 20)
+
+// Decide DNA / RNA / protein from residue counts
+SequenceType seqtype_from_counts(const ResidueCounts *rc);
+
+// Count the residues of one row; with sample_cap > 0 at most that many bytes are read,
+// taken as evenly spaced windows so long leading runs (e.g. of N) do not dominate
+void seqtype_count(const char *seq, size_t len, size_t sample_cap, ResidueCounts *rc);
+
+// Classify one row
+SequenceType seqtype_classify(const char *seq, size_t len, size_t sample_cap);
+
+// Classify every resident row of the list on the worker pool and set the alignment-wide
+// type from the combined counts; rows served by a source keep the type their parser gave them
+void seqtype_classify_list(SeqList *sl, size_t sample_cap);
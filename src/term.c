@@ -1,9 +1,13 @@
 #include "term.h"
+#include <errno.h>
 #include <stdio.h>
+#include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #include <signal.h>    // for SIGWINCH & signal()
 #include <time.h>      // for clock_gettime
 
@@ -14,26 +18,61 @@
 
 static struct termios orig;
 static volatile sig_atomic_t resized = 0;
+// Self-pipe the handler writes to, so a resize wakes a select() that started just before it
+static int resize_pipe[2] = { -1, -1 };
 
 // catch SIGWINCH
 static void handle_sigwinch(int signo) {
     (void)signo;
     resized = 1;
+    if (resize_pipe[1] >= 0) {
+        int saved_errno = errno;
+        ssize_t n = write(resize_pipe[1], "", 1);  // a full pipe already holds a wakeup
+        (void)n;
+        errno = saved_errno;
+    }
 }
 
 // called by input_read to see if a SIGWINCH arrived
 int was_resized(void) {
+    // Drain the wakeups first, so one landing after the check is still seen next time
+    char buf[64];
+    while (resize_pipe[0] >= 0 && read(resize_pipe[0], buf, sizeof(buf)) > 0) {}
     if (resized) { resized = 0; return 1; }
     return 0;
 }
 
+int resize_wakeup_fd(void) {
+    return resize_pipe[0];
+}
+
+int redirect_stdin_to_tty(void) {
+    int data_fd = dup(STDIN_FILENO);
+    if (data_fd < 0) return -1;
+
+    int tty_fd = open("/dev/tty", O_RDWR);
+    if (tty_fd < 0 || dup2(tty_fd, STDIN_FILENO) < 0) {
+        if (tty_fd >= 0) close(tty_fd);
+        close(data_fd);
+        return -1;
+    }
+    close(tty_fd);
+    return data_fd;
+}
+
 void enable_raw_mode(void) {
     tcgetattr(STDIN_FILENO, &orig);
     struct termios raw = orig;
     raw.c_lflag &= ~(ECHO | ICANON | ISIG);
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 
-    // catch window resize
+    // catch window resize; the signal may land on any thread, so it is passed on through a pipe
+    if (resize_pipe[0] < 0 && pipe(resize_pipe) == 0) {
+        for (int i = 0; i < 2; i++) {
+            fcntl(resize_pipe[i], F_SETFL, fcntl(resize_pipe[i], F_GETFL) | O_NONBLOCK);
+            fcntl(resize_pipe[i], F_SETFD, FD_CLOEXEC);
+        }
+    }
     signal(SIGWINCH, handle_sigwinch);
 }
 
@@ -80,4 +119,38 @@ long time_diff_ms(struct timespec *start, struct timespec *end) {
     long seconds = end->tv_sec - start->tv_sec;
     long nanoseconds = end->tv_nsec - start->tv_nsec;
     return seconds * 1000 + nanoseconds / 1000000;
-}
\ No newline at end of file
+}
+
+bool query_sync_output(int timeout_ms) {
+    // Every terminal answers the device attributes request, so its reply marks the end of any
+    // reply to the mode request before it
+    static const char query[] = "\x1b[?2026$p\x1b[c";
+    fflush(stdout);
+    if (write(STDOUT_FILENO, query, sizeof(query) - 1) != (ssize_t)(sizeof(query) - 1)) return false;
+
+    struct timespec start, now;
+    get_current_time(&start);
+    char reply[256];
+    size_t got = 0;
+    while (got < sizeof(reply) - 1) {
+        get_current_time(&now);
+        long left = timeout_ms - time_diff_ms(&start, &now);
+        if (left <= 0) break;
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(STDIN_FILENO, &rfds);
+        struct timeval tv = { left / 1000, (left % 1000) * 1000 };
+        if (select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv) <= 0) break;
+        ssize_t n = read(STDIN_FILENO, reply + got, sizeof(reply) - 1 - got);
+        if (n <= 0) break;
+        got += (size_t)n;
+        reply[got] = '\0';
+        if (reply[got - 1] == 'c' && strstr(reply, "\x1b[?")) break;
+    }
+    reply[got] = '\0';
+
+    // The mode is reported as 1 (set), 2 (reset) or 3 (always set) when the terminal knows it
+    const char *mode = strstr(reply, "\x1b[?2026;");
+    return mode && mode[8] >= '1' && mode[8] <= '3' && mode[9] == '$';
+}
@@ -1,14 +1,27 @@
 #pragma once
 #include <signal.h>
+#include <stdbool.h>
 #include <time.h>
 
+// Move piped input off stdin and put the controlling terminal there instead, so keys can be read
+// while the data streams in; returns a descriptor for the piped input, or -1 without a terminal
+int  redirect_stdin_to_tty(void);
+
 void enable_raw_mode(void);
 void disable_raw_mode(void);
 void enable_altscreen(void);
 void disable_altscreen(void);
 void get_term_size(int *rows, int *cols);
+
+// Ask the terminal whether it supports synchronized output (DEC private mode 2026), waiting
+// up to timeout_ms for the reply; call in raw mode
+bool query_sync_output(int timeout_ms);
 int  was_resized(void);
 
+// Descriptor that turns readable when a resize arrives, for waiting on it along with input;
+// -1 before raw mode is enabled
+int  resize_wakeup_fd(void);
+
 // Timing utilities for acceleration
 void get_current_time(struct timespec *ts);
 long time_diff_ms(struct timespec *start, struct timespec *end);
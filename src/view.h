@@ -1,5 +1,5 @@
 #pragma once
-#include "parser_fasta.h"
+#include "seqlist.h"
 #include <stdbool.h>
 #include <time.h>
 
@@ -18,6 +18,8 @@ typedef struct {
     char     jump_buffer[16]; // buffer for collecting jump digits
     int      jump_pos;   // current position in jump buffer
     bool     no_color;   // true when colors should be disabled
+    bool     sync_output; // true when the terminal draws frames at once (synchronized output)
+    int      load_percent; // while the file is still loading: percent parsed (0 if unknown), else -1
     
     // Search state
     bool     search_mode;        // true when in search mode
@@ -43,16 +43,11 @@ void view_execute_jump(ViewState *vs) {
     target_pos--;
     
     // find the maximum sequence length to clamp to
-    int max_seq_len = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_seq_len) {
-            max_seq_len = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_seq_len = (int)seqlist_max_len(vs->seqs);
     
-    // clamp to valid range
-    if (target_pos < 0) target_pos = 0;
+    // clamp to valid range (the list is empty while a load is starting)
     if (target_pos >= max_seq_len) target_pos = max_seq_len - 1;
+    if (target_pos < 0) target_pos = 0;
     
     vs->col_offset = target_pos;
     view_cancel_jump(vs);
@@ -40,12 +40,7 @@ void view_scroll_right_steps(ViewState *vs, int steps) {
     int new_col_offset = vs->col_offset + steps;
     
     // Find the maximum sequence length to determine bounds
-    int max_seq_len = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_seq_len) {
-            max_seq_len = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_seq_len = (int)seqlist_max_len(vs->seqs);
     
     // Allow scrolling until the last character position (more permissive)
     // This allows reaching the very end of sequences
@@ -155,12 +150,7 @@ void view_screen_to_sequence_pos(ViewState *vs, int screen_x, int screen_y, int
     if (*seq_col < 0) *seq_col = 0;
     
     // Find max sequence length and clamp column
-    int max_seq_len = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_seq_len) {
-            max_seq_len = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_seq_len = (int)seqlist_max_len(vs->seqs);
     if (*seq_col >= max_seq_len) *seq_col = max_seq_len - 1;
     if (max_seq_len == 0) *seq_col = 0;  // Handle empty sequences
 } 
\ No newline at end of file
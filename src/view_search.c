@@ -2,7 +2,10 @@
 #include <string.h>
 #include <stdlib.h>
 
-// Forward declarations for static functions
+// Lazy rows are searched through a window of this many residues at a time
+#define SEARCH_WINDOW 65536
+
+static char *search_window = NULL;
 
 // search mode handling
 void view_start_search(ViewState *vs) {
@@ -70,50 +73,74 @@ void view_find_matches(ViewState *vs, const char *query) {
     // For very long searches, use a more aggressive limit to maintain performance
     int max_matches = (query_len > 40) ? 1000 : 10000;
     
+    // A query without '-' or '*' cannot match across a gap, so indexed gap runs can be skipped
+    bool skip_gaps = strpbrk(query, "-*") == NULL;
+    
     // Search through all sequences
     for (size_t seq_idx = 0; seq_idx < vs->seqs->count; seq_idx++) {
-        Sequence *seq = &vs->seqs->items[seq_idx];
+        const char *seq = seqlist_row_text(vs->seqs, seq_idx);
+        size_t seq_len = vs->seqs->lens[seq_idx];
         
-        // Search through the sequence
-        for (int pos = 0; pos <= (int)seq->len - query_len; pos++) {
-            bool match = true;
+        // Plain rows are scanned in place, other rows in overlapping windows
+        size_t chunk_start = 0;
+        while (1) {
+            if (!seq && skip_gaps) chunk_start = seqlist_skip_gaps(vs->seqs, seq_idx, chunk_start);
+            if (chunk_start + query_len > seq_len) break;
+
+            const char *window = seq;
+            int window_len = (int)seq_len;
+            if (!window) {
+                if (!search_window) search_window = malloc(SEARCH_WINDOW);
+                if (!search_window) return;  // out of memory: keep the matches found so far
+                window_len = (int)seqlist_fetch(vs->seqs, seq_idx, chunk_start, SEARCH_WINDOW, search_window);
+                window = search_window;
+            }
             
-            // Check if query matches at this position (case-insensitive with wildcard support)
-            for (int i = 0; i < query_len; i++) {
-                char seq_char = seq->seq[pos + i];
-                char query_char = query[i];
+            // Search through the window
+            for (int pos = 0; pos <= window_len - query_len; pos++) {
+                bool match = true;
                 
-                // Wildcard '*' matches any character
-                if (query_char == '*') {
-                    continue;  // Always matches
+                // Check if query matches at this position (case-insensitive with wildcard support)
+                for (int i = 0; i < query_len; i++) {
+                    char seq_char = window[pos + i];
+                    char query_char = query[i];
+                    
+                    // Wildcard '*' matches any character
+                    if (query_char == '*') {
+                        continue;  // Always matches
+                    }
+                    
+                    // Convert to uppercase for comparison
+                    if (seq_char >= 'a' && seq_char <= 'z') seq_char -= 32;
+                    if (query_char >= 'a' && query_char <= 'z') query_char -= 32;
+                    
+                    if (seq_char != query_char) {
+                        match = false;
+                        break;
+                    }
                 }
                 
-                // Convert to uppercase for comparison
-                if (seq_char >= 'a' && seq_char <= 'z') seq_char -= 32;
-                if (query_char >= 'a' && query_char <= 'z') query_char -= 32;
-                
-                if (seq_char != query_char) {
-                    match = false;
-                    break;
+                if (match) {
+                    // Expand array if needed
+                    if (vs->search_matches >= vs->search_capacity) {
+                        vs->search_capacity *= 2;
+                        vs->search_results = realloc(vs->search_results, vs->search_capacity * sizeof(SearchMatch));
+                    }
+                    
+                    vs->search_results[vs->search_matches].seq_idx = seq_idx;
+                    vs->search_results[vs->search_matches].pos = (int)chunk_start + pos;
+                    vs->search_matches++;
+                    
+                    // Safety limit to prevent excessive matches (lower limit for very long searches)
+                    if (vs->search_matches >= max_matches) {
+                        return;
+                    }
                 }
             }
             
-            if (match) {
-                // Expand array if needed
-                if (vs->search_matches >= vs->search_capacity) {
-                    vs->search_capacity *= 2;
-                    vs->search_results = realloc(vs->search_results, vs->search_capacity * sizeof(SearchMatch));
-                }
-                
-                vs->search_results[vs->search_matches].seq_idx = seq_idx;
-                vs->search_results[vs->search_matches].pos = pos;
-                vs->search_matches++;
-                
-                // Safety limit to prevent excessive matches (lower limit for very long searches)
-                if (vs->search_matches >= max_matches) {
-                    return;
-                }
-            }
+            if (seq || window_len < query_len) break;
+            // next window overlaps the last query_len - 1 residues of this one
+            chunk_start += window_len - query_len + 1;
         }
     }
 }
@@ -147,12 +174,7 @@ void view_jump_to_match(ViewState *vs, int match_idx) {
     if (vs->col_offset < 0) vs->col_offset = 0;
     
     // Find max sequence length for clamping
-    int max_seq_len = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_seq_len) {
-            max_seq_len = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_seq_len = (int)seqlist_max_len(vs->seqs);
     int max_col_offset = max_seq_len - 1;
     if (max_col_offset < 0) max_col_offset = 0;
     if (vs->col_offset > max_col_offset) vs->col_offset = max_col_offset;
@@ -59,12 +59,7 @@ void view_copy_selection(ViewState *vs) {
     if (start_col < 0) start_col = 0;
     
     // Find maximum column
-    int max_col = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_col) {
-            max_col = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_col = (int)seqlist_max_len(vs->seqs);
     if (end_col >= max_col) end_col = max_col - 1;
     
     // Create a temporary file for the selected text
@@ -72,19 +67,19 @@ void view_copy_selection(ViewState *vs) {
     if (!temp_file) return;
     
     // Extract rectangular selection
+    int width = end_col - start_col + 1;
+    char *slice = malloc(width > 0 ? width : 1);
     for (int row = start_row; row <= end_row; row++) {
-        if (row < (int)vs->seqs->count) {
-            Sequence *seq = &vs->seqs->items[row];
-            for (int col = start_col; col <= end_col; col++) {
-                if (col < (int)seq->len) {
-                    fputc(seq->seq[col], temp_file);
-                } else {
-                    fputc(' ', temp_file);  // Pad with spaces if sequence is shorter
-                }
+        if (row < (int)vs->seqs->count && width > 0) {
+            int got = (int)seqlist_fetch(vs->seqs, row, start_col, width, slice);
+            fwrite(slice, 1, got, temp_file);
+            for (int col = got; col < width; col++) {
+                fputc(' ', temp_file);  // Pad with spaces if sequence is shorter
             }
         }
         fputc('\n', temp_file);
     }
+    free(slice);
     
     // Copy to clipboard using system command
     fflush(temp_file);
@@ -10,6 +10,8 @@ ViewState view_init(SeqList *s) {
         .jump_mode = false, 
         .jump_pos = 0,
         .no_color = false,
+        .sync_output = false,
+        .load_percent = -1,
         .search_mode = false,
         .search_pos = 0,
         .search_matches = 0,
@@ -41,14 +43,19 @@ void view_resize(ViewState *vs) {
     if (max_row_off < 0) max_row_off = 0;
     if (vs->row_offset > max_row_off) vs->row_offset = max_row_off;
     // clamp col_offset to not go past the end of the longest sequence
-    int max_seq_len = 0;
-    for (size_t i = 0; i < vs->seqs->count; i++) {
-        if ((int)vs->seqs->items[i].len > max_seq_len) {
-            max_seq_len = (int)vs->seqs->items[i].len;
-        }
-    }
+    int max_seq_len = (int)seqlist_max_len(vs->seqs);
     int max_col_offset = max_seq_len - 1;  // 0-based indexing
     if (max_col_offset < 0) max_col_offset = 0;
     if (vs->col_offset > max_col_offset) vs->col_offset = max_col_offset;
     if (vs->col_offset < 0) vs->col_offset = 0;
-} 
\ No newline at end of file
+}
+
+void view_replace_seqs(ViewState *vs, SeqList *s) {
+    vs->seqs = s;
+    // Rows keep their indices, but the new list may hold more matches
+    if (vs->search_matches > 0) {
+        int current = vs->search_current;
+        view_find_matches(vs, vs->search_buffer);
+        vs->search_current = current < vs->search_matches ? current : 0;
+    }
+}
@@ -3,4 +3,7 @@
 
 // Core ViewState management functions
 ViewState view_init(SeqList *s);
-void view_resize(ViewState *vs); 
\ No newline at end of file
+void view_resize(ViewState *vs);
+
+// Show another list in place of the current one (a fuller load of the same file)
+void view_replace_seqs(ViewState *vs, SeqList *s);
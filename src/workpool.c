@@ -0,0 +1,105 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "workpool.h"
+
+#define WORKPOOL_MAX_THREADS 64
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;  // one job at a time
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_posted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static size_t thread_count = 1;
+
+// The job currently being run
+static WorkFn job_fn;
+static void *job_arg;
+static size_t job_n, job_grain;
+static atomic_size_t job_next;
+static unsigned long job_generation;
+static size_t busy_workers;
+
+// Helper function to claim and run chunks until the job is exhausted
+static void run_chunks(void) {
+    while (1) {
+        size_t begin = atomic_fetch_add(&job_next, job_grain);
+        if (begin >= job_n) break;
+        size_t end = begin + job_grain < job_n ? begin + job_grain : job_n;
+        job_fn(begin, end, job_arg);
+    }
+}
+
+static void *worker_main(void *unused) {
+    (void)unused;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&lock);
+    while (1) {
+        while (job_generation == seen) pthread_cond_wait(&job_posted, &lock);
+        seen = job_generation;
+        pthread_mutex_unlock(&lock);
+
+        run_chunks();
+
+        pthread_mutex_lock(&lock);
+        if (--busy_workers == 0) pthread_cond_signal(&job_done);
+    }
+    return NULL;
+}
+
+static void pool_start(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (cpus > WORKPOOL_MAX_THREADS) cpus = WORKPOOL_MAX_THREADS;
+
+    // Workers are detached and live for the rest of the process
+    thread_count = 1;
+    for (long i = 1; i < cpus; i++) {
+        pthread_t t;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&t, &attr, worker_main, NULL) == 0) thread_count++;
+        pthread_attr_destroy(&attr);
+    }
+}
+
+size_t workpool_size(void) {
+    pthread_once(&pool_once, pool_start);
+    return thread_count;
+}
+
+void workpool_run(size_t n, size_t grain, WorkFn fn, void *arg) {
+    if (n == 0) return;
+    if (grain == 0) grain = 1;
+
+    // Not worth waking anyone for a single chunk
+    if (n <= grain || workpool_size() == 1) {
+        fn(0, n, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&run_lock);
+
+    pthread_mutex_lock(&lock);
+    job_fn = fn;
+    job_arg = arg;
+    job_n = n;
+    job_grain = grain;
+    atomic_store(&job_next, 0);
+    busy_workers = thread_count - 1;
+    job_generation++;
+    pthread_cond_broadcast(&job_posted);
+    pthread_mutex_unlock(&lock);
+
+    // The caller works too
+    run_chunks();
+
+    pthread_mutex_lock(&lock);
+    while (busy_workers > 0) pthread_cond_wait(&job_done, &lock);
+    pthread_mutex_unlock(&lock);
+
+    pthread_mutex_unlock(&run_lock);
+}
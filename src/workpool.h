@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+
+// Process-wide pool of worker threads for data-parallel loops.
+// Jobs run one at a time; a job must not start another job from inside fn.
+
+// Called with consecutive, non-overlapping ranges [begin, end) that together cover [0, n)
+typedef void (*WorkFn)(size_t begin, size_t end, void *arg);
+
+// Run fn over [0, n) in chunks of about grain items and wait until all chunks are done
+void workpool_run(size_t n, size_t grain, WorkFn fn, void *arg);
+
+// Number of threads that take part in a job (workers plus the caller)
+size_t workpool_size(void);